@@ -45,6 +45,9 @@ while True:
         print "'7' - set stiffness to 1 and take the initial position"
         print "'8' - walk (using builtin module)"
         print "'9' - reset stiffness and angles (using builtin module)"
+        print "'10' - print the estimated latency of the commands"
+        print "'11' - pause walking"
+        print "'12' - resume walking"
 
         try:
             nao_action = int (raw_input("Type a number: "))
@@ -70,8 +73,9 @@ while True:
         elif nao_action == 6:
             walk_proxy.setStiffness(0.5)
         elif nao_action == 7:
-            walk_proxy.setStiffness(1.0)
-            walk_proxy.initPosition()
+            # the joints must be stiff, before they are moved
+            walk_proxy.waitCompletion(walk_proxy.setStiffnessAsync(1.0))
+            walk_proxy.waitCompletion(walk_proxy.initPositionAsync())
         elif nao_action == 8:
             motion_proxy.stiffnessInterpolation("Body", 1.0, 0.1)
             motion_proxy.setWalkArmsEnabled(False, False)
@@ -88,6 +92,12 @@ while True:
             numAngles = len(motion_proxy.getJointNames("Body"))
             angles = [0.0] * numAngles
             motion_proxy.angleInterpolationWithSpeed ("Body", angles, 0.3)
+        elif nao_action == 10:
+            print "Latency: %f ms (confidence %f)" % (walk_proxy.getLatencyEstimate(), walk_proxy.getLatencyConfidence())
+        elif nao_action == 11:
+            walk_proxy.pauseWalking()
+        elif nao_action == 12:
+            walk_proxy.resumeWalking()
 
 
     except Exception,e:
@@ -96,7 +106,7 @@ while True:
 
 
     # leave if requested
-    if nao_action < 1 or nao_action > 9 or options.nao_action != 0:
+    if nao_action < 1 or nao_action > 12 or options.nao_action != 0:
         print '----- The script was stopped'
         break
 
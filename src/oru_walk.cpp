@@ -8,6 +8,8 @@
 #include <qi/os.hpp>
 
 #include "oru_walk.h"
+#include "robot_io_naoqi.h"
+#include "robot_io_sim.h"
 
 
 /**
@@ -17,8 +19,8 @@
  */
 oru_walk::oru_walk(ALPtr<ALBroker> broker, const string& name) : 
     ALModule(broker, name),
-    access_sensor_values (ALPtr<ALMemoryFastAccess>(new ALMemoryFastAccess())),
-    wp (broker)
+    wp (broker),
+    startup_timer ("startup", 0)
 {
     setModuleDescription("Orebro University: NAO walking module");
 
@@ -28,16 +30,83 @@ oru_walk::oru_walk(ALPtr<ALBroker> broker, const string& name) :
     addParam( "value", "new stiffness value from 0.0 to 1.0");
     BIND_METHOD( oru_walk::setStiffness );
 
+    functionName( "setStiffnessAsync" , getName(), "start changing stiffness of all joint");
+    addParam( "value", "new stiffness value from 0.0 to 1.0");
+    setReturn( "handle", "DCM time, when the change is finished");
+    BIND_METHOD( oru_walk::setStiffnessAsync );
+
     functionName( "initPosition", getName() , "initialize robot position");
     BIND_METHOD( oru_walk::initPosition );
 
+    functionName( "initPositionAsync", getName() , "start moving to the initial position");
+    setReturn( "handle", "DCM time, when the position is reached");
+    BIND_METHOD( oru_walk::initPositionAsync );
+
+    functionName( "isCompleted", getName() , "check if an asynchronous command is completed");
+    addParam( "handle", "the value returned by an asynchronous command");
+    setReturn( "completed", "true if the command is completed");
+    BIND_METHOD( oru_walk::isCompleted );
+
+    functionName( "waitCompletion", getName() , "wait for completion of an asynchronous command");
+    addParam( "handle", "the value returned by an asynchronous command");
+    BIND_METHOD( oru_walk::waitCompletion );
+
     functionName( "walk", getName() , "walk");
     BIND_METHOD( oru_walk::walk );
 
+    functionName( "waitWalking", getName() , "wait for the end of walking, fails if the walk has failed");
+    BIND_METHOD( oru_walk::waitWalking );
+
     functionName( "stopWalking", getName() , "stopWalking");
     BIND_METHOD( oru_walk::stopWalkingRemote );
 
+    functionName( "pauseWalking", getName() , "pause walking, the robot holds its posture");
+    BIND_METHOD( oru_walk::pauseWalking );
+
+    functionName( "resumeWalking", getName() , "resume paused walking");
+    BIND_METHOD( oru_walk::resumeWalking );
+
+    functionName( "getLatencyEstimate", getName() , "get the estimated latency of the commands (ms)");
+    setReturn( "latency", "latency in ms");
+    BIND_METHOD( oru_walk::getLatencyEstimate );
+
+    functionName( "getLatencyConfidence", getName() , "get the confidence of the estimated latency");
+    setReturn( "confidence", "normalized correlation from 0.0 to 1.0");
+    BIND_METHOD( oru_walk::getLatencyConfidence );
+
+    robot_io = NULL;
+    simulated_dcm_forced = false;
     solver = NULL;
+    for (int i = 0; i < ORUW_SOLVER_LADDER_SIZE; i++)
+    {
+        solver_ladder[i] = NULL;
+    }
+    sem_init (&walk_control_sem, 0, 0);
+
+    latency_estimate_ms = 0.0;
+    latency_confidence = 0.0;
+
+    pending_completion = false;
+    pending_completion_time_ms = 0;
+
+    ik_stage_thread = NULL;
+    sem_init (&ik_stage_sem, 0, 0);
+
+    watchdog_thread = NULL;
+    watchdog_triggered = false;
+
+    shadow_mpc = NULL;
+
+    empc_enabled = false;
+    empc_used = false;
+
+    first_walk = true;
+
+    walk_active = false;
+    walk_paused = false;
+    walk_stop_requested = false;
+    sem_init (&walk_resume_sem, 0, 0);
+    sem_init (&walk_parked_sem, 0, 0);
 }
 
 
@@ -47,13 +116,28 @@ oru_walk::oru_walk(ALPtr<ALBroker> broker, const string& name) :
  */
 oru_walk::~oru_walk()
 {
-    setStiffness(0.0f);
-    // Remove the postProcess call back connection
-    stopWalking ("Module destroyed.\n");
-    if (solver != NULL)
+    if (robot_io != NULL)
+    {
+        setStiffness(0.0f);
+        // Remove the postProcess call back connection
+        stopWalking ("Module destroyed.\n");
+    }
+    control_worker.stop();
+    for (int i = 0; i < ORUW_SOLVER_LADDER_SIZE; i++)
+    {
+        solver_ladder[i] = NULL;
+    }
+    solver = NULL;
+    solver_cache.clear();
+    sem_destroy (&walk_control_sem);
+    sem_destroy (&ik_stage_sem);
+    sem_destroy (&walk_resume_sem);
+    sem_destroy (&walk_parked_sem);
+
+    if (robot_io != NULL)
     {
-        delete solver;
-        solver = NULL;
+        delete robot_io;
+        robot_io = NULL;
     }
 }
 
@@ -65,44 +149,28 @@ oru_walk::~oru_walk()
  */
 void oru_walk::init()
 {
-    bool isDCMRunning;
-
-
-    // Is the DCM running ?
-    try
-    {
-        isDCMRunning = getParentBroker()->getProxy("ALLauncher")->call<bool>("isModulePresent", std::string("DCM"));
-    }
-    catch (ALError& e)
-    {
-        ORUW_THROW_ERROR("Error when connecting to DCM: ", e);
-    }
+    oruw_timer timer ("init", 0);
 
-    if (!isDCMRunning)
-    {
-        ORUW_THROW("Error no DCM running");
-    }
+    // the choice of the DCM cannot be changed later
+    wp.readParameters();
+    logStartupStep ("parameters", timer);
 
     try
     {
-        // Get the DCM proxy
-        dcm_proxy = getParentBroker()->getDcmProxy();
+        if (wp.simulated_dcm || simulated_dcm_forced)
+        {
+            robot_io = new robotIOSim (wp.dcm_sampling_time_ms, wp.simulated_dcm_delay_ms);
+        }
+        else
+        {
+            robot_io = new robotIONaoqi (getParentBroker());
+        }
     }
     catch (ALError& e)
     {
-        ORUW_THROW_ERROR("Impossible to create DCM Proxy: ", e);
-    }
-
-
-    try
-    {
-        // Get the memory proxy
-        memory_proxy = getParentBroker()->getMemoryProxy();
-    }
-    catch (ALError& e)
-    {
-        ORUW_THROW_ERROR("Impossible to create memory proxy: ", e);
+        ORUW_THROW_ERROR("Cannot connect to the robot: ", e);
     }
+    logStartupStep ("connection to the robot", timer);
 
 
 
@@ -137,70 +205,113 @@ void oru_walk::init()
     joint_names[R_WRIST_YAW]      += "RWristYaw";
 
 
-    initFastRead(joint_names);
-    initFastWrite(joint_names);
+    robot_io->connect(joint_names);
+    logStartupStep ("sensors and aliases", timer);
+    // the buffer is not resized later
+    sensor_values.resize(SENSORS_NUM);
     initWalkCommands();
+    logStartupStep ("commands", timer);
+
+
+    // the control thread is reused by all walks
+    try
+    {
+        boost::thread &control_thread = control_worker.start (boost::bind(&oru_walk::walkControlJob, this));
+        setThreadPriority (control_thread, wp.walk_control_thread_priority);
+        if (wp.walk_control_rt_mode && (wp.walk_control_thread_cpu >= 0))
+        {
+            setThreadAffinity (control_thread, wp.walk_control_thread_cpu);
+        }
+    }
+    catch (...)
+    {
+        ORUW_THROW("Failed to spawn the walk control thread.");
+    }
+    logStartupStep ("control thread", timer);
+}
+
+
+
+/**
+ * @brief Use the simulated DCM regardless of the parameters, must be
+ * called before init(). The module can be tested without the robot.
+ */
+void oru_walk::forceSimulatedDCM()
+{
+    simulated_dcm_forced = true;
+}
+
+
+
+/**
+ * @brief Log the duration of a step of initialization.
+ *
+ * @param[in] step name of the step
+ * @param[in,out] timer the timer, which is reset
+ */
+void oru_walk::logStartupStep (const char *step, oruw_timer &timer)
+{
+    qiLogInfo ("module.oru_walk") << "Startup: " << step << " = " << timer.elapsed() * 1000 << " ms";
+    timer.reset();
 }
 
 
 /**
- * @brief Set stiffness of joints.
+ * @brief Set stiffness of joints, returns when the change is finished.
  *
  * @param[in] stiffnessValue value of stiffness [0;1]
  */
 void oru_walk::setStiffness(const float &stiffnessValue)
 {
-    ALValue stiffnessCommands;
+    waitCompletion (setStiffnessAsync (stiffnessValue));
+    qiLogInfo ("module.oru_walk", "Execution of setStiffness() is finished.");
+}
+
 
 
+/**
+ * @brief Start changing stiffness of joints.
+ *
+ * @param[in] stiffnessValue value of stiffness [0;1]
+ *
+ * @return the DCM time, when the change is finished (see isCompleted()).
+ */
+int oru_walk::setStiffnessAsync(const float &stiffnessValue)
+{
     if ((stiffnessValue < 0) || (stiffnessValue > 1))
     {
         ORUW_THROW("Wrong parameters");
     }
 
 
-    // Prepare one dcm command:
-    // it will linearly "Merge" all joint stiffness
-    // from last value to "stiffnessValue" in 1 seconde
-    stiffnessCommands.arraySetSize(3);
-    stiffnessCommands[0] = std::string("jointStiffness");
-    stiffnessCommands[1] = std::string("Merge");
-    stiffnessCommands[2].arraySetSize(1);
-    stiffnessCommands[2][0].arraySetSize(2);
-    stiffnessCommands[2][0][0] = stiffnessValue;
-
-
     /// @attention Hardcoded parameter!
     unsigned int stiffness_change_time = 1000;
-    try
-    {
-        stiffnessCommands[2][0][1] = dcm_proxy->getTime(stiffness_change_time);
-    }
-    catch (const ALError &e)
-    {
-        ORUW_THROW_ERROR("Error on DCM getTime : ", e);
-    }
+    int completion_time_ms = robot_io->setStiffness (stiffnessValue, stiffness_change_time);
 
+    addPendingCompletion (completion_time_ms);
+    return (completion_time_ms);
+}
 
-    try
-    {
-        dcm_proxy->set(stiffnessCommands);
-    }
-    catch (const ALError &e)
-    {
-        ORUW_THROW_ERROR("Error when sending stiffness to DCM : ", e);
-    }
 
-    qi::os::msleep(stiffness_change_time);
-    qiLogInfo ("module.oru_walk", "Execution of setStiffness() is finished.");
+
+/**
+ * @brief Move the joints to the initial position, returns when the
+ * position is reached.
+ */
+void oru_walk::initPosition()
+{
+    waitCompletion (initPositionAsync());
+    qiLogInfo ("module.oru_walk", "Execution of initPosition() is finished.");
 }
 
 
 
 /**
- * @brief 
+ * @brief Start moving the joints to the initial position.
+ *
+ * @return the DCM time, when the position is reached (see isCompleted()).
  */
-void oru_walk::initPosition()
+int oru_walk::initPositionAsync()
 {
     /// @attention Hardcoded parameter!
     unsigned int init_time = 1200;
@@ -228,9 +339,11 @@ void oru_walk::initPosition()
 
 
     // set time
+    int completion_time_ms;
     try
     {
-        initPositionCommands[4][0] = dcm_proxy->getTime(init_time);
+        completion_time_ms = robot_io->getTime(init_time);
+        initPositionCommands[4][0] = completion_time_ms;
     }
     catch (const ALError &e)
     {
@@ -241,13 +354,67 @@ void oru_walk::initPosition()
     // send commands
     try
     {
-        dcm_proxy->setAlias(initPositionCommands);
+        robot_io->setAlias(initPositionCommands);
     }
     catch (const AL::ALError &e)
     {
         ORUW_THROW_ERROR("Error with DCM setAlias : ", e);
     }
 
-    qi::os::msleep(init_time);
-    qiLogInfo ("module.oru_walk", "Execution of initPosition() is finished.");
+    addPendingCompletion (completion_time_ms);
+    return (completion_time_ms);
+}
+
+
+
+/**
+ * @brief Remember the latest DCM time, when the asynchronous commands are
+ * completed; walk() waits for it.
+ *
+ * @param[in] completion_time_ms DCM time
+ */
+void oru_walk::addPendingCompletion (const int completion_time_ms)
+{
+    boost::mutex::scoped_lock lock(completion_mutex);
+    if (!pending_completion || (completion_time_ms - pending_completion_time_ms > 0))
+    {
+        pending_completion_time_ms = completion_time_ms;
+    }
+    pending_completion = true;
+}
+
+
+
+/**
+ * @brief Check if an asynchronous command is completed.
+ *
+ * @param[in] handle the value returned by setStiffnessAsync() or
+ * initPositionAsync().
+ *
+ * @return true if the DCM time of the completion is reached.
+ */
+bool oru_walk::isCompleted(const int &handle)
+{
+    return (robot_io->getCycleTime() - handle >= 0);
+}
+
+
+
+/**
+ * @brief Wait for completion of an asynchronous command.
+ *
+ * @param[in] handle the value returned by setStiffnessAsync() or
+ * initPositionAsync().
+ */
+void oru_walk::waitCompletion(const int &handle)
+{
+    for (;;)
+    {
+        int remaining_ms = handle - robot_io->getCycleTime();
+        if (remaining_ms <= 0)
+        {
+            break;
+        }
+        qi::os::msleep(remaining_ms);
+    }
 }
@@ -16,6 +16,8 @@
 
 // standard headers
 #include <string> // string
+#include <semaphore.h> // sem_t
+#include <sys/resource.h> // rusage
 
 
 // NAO headers
@@ -30,11 +32,6 @@
 
 #include <alvalue/alvalue.h> // ALValue
 
-#include <alproxies/dcmproxy.h>
-#include <alproxies/almemoryproxy.h>
-
-#include <almemoryfastaccess/almemoryfastaccess.h>
-
 #include <althread/almutex.h>
 
 
@@ -51,6 +48,19 @@
 #include "joints_sensors_id.h"
 #include "nao_igm.h"
 #include "walk_parameters.h"
+#include "robot_io.h"
+#include "walk_commands.h"
+#include "sensor_snapshot.h"
+#include "oruw_triple_buffer.h"
+#include "oruw_sensor_history.h"
+#include "oruw_latency_estimator.h"
+#include "oruw_scheduler.h"
+#include "oruw_spsc_queue.h"
+#include "oruw_worker.h"
+#include "oruw_percentile_window.h"
+#include "oruw_timer.h"
+#include "oruw_solver_cache.h"
+#include "oruw_empc_table.h"
 
 
 
@@ -65,6 +75,37 @@ using namespace std;
 #define ORUW_THROW(message) throw ALERROR(getName(), __FUNCTION__, message)
 #define ORUW_THROW_ERROR(message,error) throw ALERROR(getName(), __FUNCTION__, message + string (error.what()))
 
+/// the number of solvers used in the anytime mode
+#define ORUW_SOLVER_LADDER_SIZE 4
+/// the number of lengths of the preview window in the adaptive mode
+#define ORUW_HORIZON_LEVELS 3
+/// decay of the estimates of execution time per control loop
+#define ORUW_SOLVER_TIME_DECAY 0.99
+/// the number of control loops used by the effort controller
+#define ORUW_EFFORT_WINDOW_SIZE 100
+/// the number of DCM cycles stored in the history of the sensor data
+#define ORUW_SENSOR_HISTORY_SIZE 64
+
+
+
+/**
+ * @brief Data passed from the MPC stage to the IK stage of the pipelined
+ * control loop.
+ */
+class ikTask
+{
+    public:
+        /// CoM positions for the first and the second control loops
+        smpc::state_com CoM[2];
+        /// positions of the feet for the first and the second control loops
+        Transform<double,3> left_foot_posture[2];
+        Transform<double,3> right_foot_posture[2];
+
+        double hCoM;
+        int dcm_time_ms;
+        bool switch_support;
+};
+
 
 
 /**
@@ -85,66 +126,301 @@ public:
 // These methods will be advertised to other modules.
     void stopWalkingRemote();
     void initPosition();
+    int initPositionAsync();
     void setStiffness(const float &);
+    int setStiffnessAsync(const float &);
+    bool isCompleted(const int &);
+    void waitCompletion(const int &);
     void walk();
+    void waitWalking();
+    void pauseWalking();
+    void resumeWalking();
+    float getLatencyEstimate();
+    float getLatencyConfidence();
+
+    // not advertised, used by the tests
+    void forceSimulatedDCM();
 
 //    EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
 
 private:
     // initialization
-    void initFastRead (const vector<string>&);
-    void initFastWrite (const vector<string>&);
     void initWalkCommands ();
     void initJointAngles (ALValue &);
+    void logStartupStep (const char *, oruw_timer &);
+    void addPendingCompletion (const int);
 
     void initWalkPattern(WMG &);
     void initWalkPattern_Straight(WMG &);
     void initWalkPattern_Diagonal(WMG &);
     void initWalkPattern_Circular(WMG &);
     void initSolver();
+    smpc::solver * createSolver(const int, const int, const int);
+    smpc::solver * getSolver(const int, const int, const int);
 
 
     // walking
-    void readSensors (jointState&);
-    bool solveMPCProblem (WMG&, smpc_parameters&);
+    void readSensors (sensorSnapshot&);
+    bool waitForSensors ();
+    bool solveMPCProblem (WMG&, smpc_parameters&, const double);
+    int selectSolver (const int, const double);
+
+    // closed-loop control of the effort of the solvers
+    void initEffortControl ();
+    void adaptEffort (const double);
+
+    // explicit MPC
+    void initMPCLookup (const double);
+    bool lookupMPCSolution (smpc_parameters&);
+    void getMPCState (smpc::state_com &, const int);
+    void logMPCLookup ();
+
+    // solution of the same problems by the other solver
+    void startShadowSolver ();
+    void stopShadowSolver ();
+    bool prepareShadowProblem (const smpc_parameters&);
+    void postShadowProblem (const smpc::state_com &, const double);
+    void solveShadowProblem ();
+
+    // adaptation of the length of the preview window
+    void initHorizon ();
+    void selectHorizon ();
+    void adaptHorizon (const double);
+    void logHorizon ();
+
+    // estimation of the latency of the commands
+    void initLatencyEstimation ();
+    void estimateLatency (const int, const jointState &);
+    int shiftCommandTime (const int, const int);
     void solveIKsendCommands (const smpc_parameters&, const smpc::state_com &, const int, WMG&);
+    void solveIKsendCommandsHorizon (const smpc_parameters&, WMG&, jointState&);
+    void solveIK (nao_igm &, const double, const smpc::state_com &);
+    void sendCommands (const jointState &, const int, const int);
+    void sendCommands (const jointState &, const jointState &, const int, const int);
+
+    // concurrent IK
+    void solveIKsendCommandsParallel (const smpc_parameters&, WMG&);
+    void solveSecondIK ();
+
+    // multi-rate control loop
+    void initMultiRate (const jointState &);
+    void setMultiRateCoM (const smpc::state_com &);
+    void solveIKsendCommandsMultiRate (const smpc_parameters&, WMG&);
+
+    // pipelined control loop
+    void startIKStage ();
+    void stopIKStage ();
+    void pushIKTask (const smpc_parameters&, WMG&, const bool);
+    void walkIKStage ();
 
     void correctNextSupportPosition(WMG &);
     void feedbackError (smpc::state_com &);
 
     void halt(const char*, const char *);
+    void requestStop(const char*);
     void stopWalking(const char*);
 
+    void setThreadPriority (boost::thread &, const int);
+
+    // real-time hardening
+    void lockMemory();
+    void setThreadAffinity (boost::thread &, const int);
+    void prefaultStack();
+    void prefaultWorkspaces();
+    void startRUsage();
+    void logRUsage();
+
     void walkControl();
+    void walkControlJob();
     // periodically called callback function
     void dcmCallback();
 
+    // pausing
+    bool parkControlThread();
 
-// private variables
-    ProcessSignalConnection dcm_callback_connection;
+    // watchdog
+    void startWatchdog();
+    void stopWatchdog();
+    void watchdog();
+    void sendSafeCommands();
 
-    // Used for fast memory access
-    ALPtr<ALMemoryFastAccess> access_sensor_values;
-    int* last_dcm_time_ms_ptr;
+
+// private variables
+    // sensors, actuators and the clock of the DCM
+    robotIO *robot_io;
+    // the simulated DCM is used regardless of the parameters
+    bool simulated_dcm_forced;
+    // preallocated buffer for the values of sensors
+    vector<float> sensor_values;
 
     // Used to store command to send
-    ALValue joint_commands;
+    walkCommands joint_commands;
+    // commands for two control loops
+    walkCommands joint_commands_pair;
+    // commands for wp.command_horizon samples of the MPC solution
+    walkCommands joint_commands_horizon;
+    // sent by the watchdog
+    walkCommands safe_commands;
 
 
     nao_igm nao;
     double ref_joint_angles[LOWER_JOINTS_NUM];
 
+    // the latest DCM time, when the asynchronous commands are completed
+    boost::mutex completion_mutex;
+    bool pending_completion;
+    int pending_completion_time_ms;
+
     walkParameters wp;
     smpc::solver *solver;
-
-    int dcm_loop_counter;
+    // solvers with decreasing limits on the number of iterations, 'solver'
+    // points to one of them (only the first one is used by default)
+    smpc::solver *solver_ladder[ORUW_SOLVER_LADDER_SIZE];
+    // owns the solvers, which are reused by the walks with the same parameters
+    oruw_solver_cache solver_cache;
+    // estimated execution time of each solver (in seconds)
+    double solver_time_estimate[ORUW_SOLVER_LADDER_SIZE];
+    // the number of control loops, in which a faster solver was used
+    int mpc_truncated_num;
+
+    // execution time of the recent control loops
+    oruw_percentile_window<ORUW_EFFORT_WINDOW_SIZE> loop_time_window;
+    // the lowest level of the solver ladder used, set by the effort controller
+    int effort_level;
+    // solvers for the shorter preview windows, the first one is not used
+    smpc::solver *solver_horizon[ORUW_HORIZON_LEVELS];
+    int horizon_size[ORUW_HORIZON_LEVELS];
+    // the number of control loops with each length of the preview window
+    int horizon_loops_num[ORUW_HORIZON_LEVELS];
+    // index of the current length of the preview window
+    int horizon_level;
+    int horizon_slack_loops;
+    // limit on the number of IK iterations, set by the effort controller
+    int igm_max_iter;
+
+    volatile int dcm_loop_counter;
     int last_dcm_time_ms;
 
-    ALPtr<DCMProxy> dcm_proxy;
-    ALPtr<ALMemoryProxy> memory_proxy;
 
-    boost::condition_variable walk_control_condition;
-    boost::mutex walk_control_mutex;
+    // sensor data is passed from the DCM callback to the control thread
+    oruw_triple_buffer<sensorSnapshot> sensor_buffer;
+    // the latest sensor data in the control thread, all consumers must
+    // use this copy
+    sensorSnapshot sensors;
+    // the sensor data of all cycles of the DCM
+    oruw_sensor_history<ORUW_SENSOR_HISTORY_SIZE> sensor_history;
+    // sensor data and the joint angles used by the feedback
+    sensorSnapshot feedback_sensors;
+    jointState feedback_joint_state;
+    // the DCM time, when the first angles of the last commands were due
+    // (may be set by the IK thread in the pipeline mode)
+    volatile int last_command_time_ms;
+
+    // estimation of the latency, is performed by the thread sending the
+    // commands
+    oruw_latency_estimator latency_estimator;
+    double latency_filtered_ms;
+    // added to the time of the commands (dcm_time_shift_ms, if the
+    // latency is not estimated)
+    int command_time_shift_ms;
+    // the last estimate, read by the remote calls
+    volatile float latency_estimate_ms;
+    volatile float latency_confidence;
+    // posted by the DCM callback to wake up the control thread
+    sem_t walk_control_sem;
+    // used instead of the semaphore in CONTROL_SCHEDULER_DEADLINE mode
+    oruw_scheduler control_scheduler;
+
+    // the IK stage of the pipelined control loop
+    boost::thread *ik_stage_thread;
+
+    // time from the creation of the module to the first walk
+    oruw_timer startup_timer;
+    bool first_walk;
+
+    // the control thread, which is created in init() and executes the
+    // control loop of each walk
+    oruw_worker control_worker;
+    // the control loop is running
+    volatile bool walk_active;
+    // the control thread is (or must be) parked
+    volatile bool walk_paused;
+    volatile bool walk_stop_requested;
+    // posted to unpark the control thread
+    sem_t walk_resume_sem;
+    // posted by the control thread, when it is parked
+    sem_t walk_parked_sem;
+    // serializes pauseWalking(), resumeWalking() and stopWalking()
+    boost::mutex pause_mutex;
+
+    // watchdog
+    boost::thread *watchdog_thread;
+    // serializes startWatchdog() and stopWatchdog()
+    boost::mutex watchdog_mutex;
+    volatile bool watchdog_stop;
+    // the control thread must not send commands, when it is set
+    volatile bool watchdog_triggered;
+    // incremented by the control thread in each loop
+    volatile int control_heartbeat;
+    sensorSnapshot safe_sensors;
+    jointState safe_joint_state;
+    // the last commanded posture, is published by the thread sending the
+    // commands and used by the watchdog, if the sensor history is empty
+    oruw_triple_buffer<jointState> safe_posture_buffer;
+    sem_t ik_stage_sem;
+    oruw_spsc_queue<ikTask, 4> ik_tasks;
+    // the model used by the IK stage, the MPC stage uses 'nao'
+    nao_igm nao_ik;
+    // the results of IK are passed back to the MPC stage
+    oruw_triple_buffer<jointState> ik_model_buffer;
+    volatile bool ik_stage_stop;
+    volatile bool ik_stage_failed;
+
+    // resource usage of the control thread at the beginning of the walk
+    struct rusage walk_rusage;
+
+    // the second IK problem is solved in parallel with the first one
+    oruw_worker ik_worker;
+    nao_igm nao_ik_parallel;
+    smpc::state_com ik_parallel_CoM;
+    double ik_parallel_hCoM;
+
+    // precomputed control laws
+    oruw_empc_table empc_table;
+    oruw_empc_problem empc_problem;
+    bool empc_enabled;
+    // set if the last solution is taken from the table
+    bool empc_used;
+    smpc::state_com empc_states[ORUW_EMPC_STATES_NUM];
+    int empc_hits_num;
+    int empc_misses_num;
+    // the misses, where the evaluated solution violates the bounds
+    int empc_rejected_num;
+
+    // the shadow solver works on a copy of the MPC problem
+    oruw_worker shadow_worker;
+    smpc::solver *shadow_solver;
+    int shadow_solver_type;
+    smpc_parameters *shadow_mpc;
+    // results of the primary solver for the copied problem
+    smpc::state_com shadow_primary_state;
+    double shadow_primary_time;
+    int shadow_primary_iterations;
+    int shadow_primary_tick;
+    // statistics
+    int shadow_tick_num;
+    int shadow_skipped_num;
+    int shadow_solved_num;
+    double shadow_primary_time_sum;
+    double shadow_time_sum;
+    double shadow_max_deviation;
+
+    // the multi-rate control loop
+    int multirate_loop_index;
+    // the initial and the first states of the last MPC solution
+    smpc::state_com multirate_CoM[2];
+    // target joint angles of the previous control loop
+    jointState multirate_last_target;
 };
 
 #endif  // ORU_WALK_H
@@ -0,0 +1,96 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief Interposition of memory allocation functions, which is used to
+ * check, that the control loop does not allocate memory. Only glibc is
+ * supported.
+ */
+
+
+#include "oruw_alloc.h"
+
+
+#ifdef ORUW_ALLOC_TRACKING_ENABLE
+#include <cstdlib>
+#include <new>
+
+
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *__libc_calloc(size_t, size_t);
+extern "C" void *__libc_realloc(void *, size_t);
+extern "C" void __libc_free(void *);
+
+
+__thread bool oruw_alloc_tracking = false;
+__thread int oruw_alloc_counter = 0;
+__thread int oruw_alloc_checked = 0;
+
+
+static inline void oruw_alloc_count()
+{
+    if (oruw_alloc_tracking)
+    {
+        ++oruw_alloc_counter;
+    }
+}
+
+
+
+extern "C" void *malloc(size_t size)
+{
+    oruw_alloc_count();
+    return (__libc_malloc(size));
+}
+
+
+extern "C" void *calloc(size_t num, size_t size)
+{
+    oruw_alloc_count();
+    return (__libc_calloc(num, size));
+}
+
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    oruw_alloc_count();
+    return (__libc_realloc(ptr, size));
+}
+
+
+
+void *operator new(std::size_t size) throw(std::bad_alloc)
+{
+    oruw_alloc_count();
+    void *ptr = __libc_malloc(size);
+    if (ptr == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return (ptr);
+}
+
+
+void *operator new[](std::size_t size) throw(std::bad_alloc)
+{
+    oruw_alloc_count();
+    void *ptr = __libc_malloc(size);
+    if (ptr == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return (ptr);
+}
+
+
+void operator delete(void *ptr) throw()
+{
+    __libc_free(ptr);
+}
+
+
+void operator delete[](void *ptr) throw()
+{
+    __libc_free(ptr);
+}
+#endif // ORUW_ALLOC_TRACKING_ENABLE
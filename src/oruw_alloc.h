@@ -0,0 +1,52 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef ORUW_ALLOC_H
+#define ORUW_ALLOC_H
+
+/**
+ * Enable tracking of memory allocations. Normally this macro is defined
+ * in the command line of a test build.
+ */
+//#define ORUW_ALLOC_TRACKING_ENABLE
+
+
+#ifdef ORUW_ALLOC_TRACKING_ENABLE
+
+/// true if allocations in the current thread must be counted
+extern __thread bool oruw_alloc_tracking;
+/// the number of allocations in the current thread since tracking is started
+extern __thread int oruw_alloc_counter;
+/// the value of oruw_alloc_counter at the last checkpoint
+extern __thread int oruw_alloc_checked;
+
+
+/// start counting allocations in the current thread, if not started yet
+#define ORUW_ALLOC_TRACKING_START \
+    if (!oruw_alloc_tracking) {oruw_alloc_counter = 0; oruw_alloc_checked = 0; oruw_alloc_tracking = true;}
+
+#define ORUW_ALLOC_TRACKING_STOP \
+    oruw_alloc_tracking = false;
+
+/// remember the current number of allocations
+#define ORUW_ALLOC_TRACKING_CHECKPOINT \
+    oruw_alloc_checked = oruw_alloc_counter;
+
+#define ORUW_ALLOC_CHECKED_NUM oruw_alloc_checked
+
+
+#else // ORUW_ALLOC_TRACKING_ENABLE
+
+
+#define ORUW_ALLOC_TRACKING_START
+#define ORUW_ALLOC_TRACKING_STOP
+#define ORUW_ALLOC_TRACKING_CHECKPOINT
+#define ORUW_ALLOC_CHECKED_NUM 0
+
+
+#endif // ORUW_ALLOC_TRACKING_ENABLE
+
+#endif // ORUW_ALLOC_H
@@ -0,0 +1,460 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef ORUW_EMPC_TABLE_H
+#define ORUW_EMPC_TABLE_H
+
+
+#include <cstdio>
+#include <cstring> // memcpy, memcmp, memset
+#include <cmath> // floor, fabs, cos, sin
+#include <vector>
+#include <algorithm> // sort, lower_bound
+
+#include "WMG.h"
+#include "smpc_solver.h"
+
+
+/// the number of states of the solution, which are stored in the table
+#define ORUW_EMPC_STATES_NUM 2
+/// the number of state variables
+#define ORUW_EMPC_STATE_SIZE 6
+/// the maximal number of steps in the preview window
+#define ORUW_EMPC_STEPS_NUM 8
+/// parameters of a step: position and orientation
+#define ORUW_EMPC_STEP_SIZE 3
+#define ORUW_EMPC_PARAMS_NUM (ORUW_EMPC_STEPS_NUM * ORUW_EMPC_STEP_SIZE)
+/// the maximal length of the preview window
+#define ORUW_EMPC_SAMPLES_NUM 64
+/// the number of values in the key of a sample: the first sample of a step
+/// flag, sampling time, reference point, bounds
+#define ORUW_EMPC_SAMPLE_KEY_SIZE 8
+#define ORUW_EMPC_KEY_SIZE (ORUW_EMPC_SAMPLES_NUM * ORUW_EMPC_SAMPLE_KEY_SIZE)
+/// the values are rounded to this quantum, when the key is formed
+#define ORUW_EMPC_QUANTUM 1e-6
+/// tolerance of the check of the bounds on the ZMP
+#define ORUW_EMPC_BOUNDS_TOLERANCE 1e-4
+#define ORUW_EMPC_VERSION 2
+
+
+
+/**
+ * @brief A preview window split into the structure, which is used as the
+ * key, and the parameters of the steps, which may be changed by the
+ * correction of the position of the next support foot.
+ *
+ * A step is a sequence of samples with the same position and orientation
+ * of the foot. The structure includes the sampling times, the bounds, the
+ * lengths of the steps and the reference ZMP points in the frames of the
+ * feet. The problem does not change, when all positions are shifted,
+ * hence the positions are taken relatively to the first step (the origin).
+ */
+class oruw_empc_problem
+{
+    public:
+        /**
+         * @brief Decompose the preview window.
+         *
+         * @param[in] mpc MPC parameters
+         * @param[in] N the length of the preview window
+         *
+         * @return false if the preview window is too long or contains too
+         * many steps.
+         */
+        bool set (const smpc_parameters &mpc, const int N)
+        {
+            if (N > ORUW_EMPC_SAMPLES_NUM)
+            {
+                return (false);
+            }
+
+            origin_x = mpc.fp_x[0];
+            origin_y = mpc.fp_y[0];
+            key_size = 0;
+            steps_num = 0;
+
+            for (int i = 0; i < N; i++)
+            {
+                bool step_start = false;
+                if ((i == 0)
+                        || (mpc.fp_x[i] != mpc.fp_x[i-1])
+                        || (mpc.fp_y[i] != mpc.fp_y[i-1])
+                        || (mpc.angle[i] != mpc.angle[i-1]))
+                {
+                    if (steps_num == ORUW_EMPC_STEPS_NUM)
+                    {
+                        return (false);
+                    }
+                    params[steps_num * ORUW_EMPC_STEP_SIZE]     = mpc.fp_x[i] - origin_x;
+                    params[steps_num * ORUW_EMPC_STEP_SIZE + 1] = mpc.fp_y[i] - origin_y;
+                    params[steps_num * ORUW_EMPC_STEP_SIZE + 2] = mpc.angle[i];
+                    step_end[steps_num] = i + 1;
+                    ++steps_num;
+                    step_start = true;
+                }
+                else
+                {
+                    step_end[steps_num - 1] = i + 1;
+                }
+
+                const double cos_a = cos (mpc.angle[i]);
+                const double sin_a = sin (mpc.angle[i]);
+                const double ref_x = mpc.zref_x[i] - mpc.fp_x[i];
+                const double ref_y = mpc.zref_y[i] - mpc.fp_y[i];
+
+                key[key_size++] = step_start ? 1 : 0;
+                addKeyValue (mpc.T[i]);
+                addKeyValue ( cos_a * ref_x + sin_a * ref_y);
+                addKeyValue (-sin_a * ref_x + cos_a * ref_y);
+                addKeyValue (mpc.lb[2*i]);
+                addKeyValue (mpc.lb[2*i + 1]);
+                addKeyValue (mpc.ub[2*i]);
+                addKeyValue (mpc.ub[2*i + 1]);
+            }
+            for (int i = key_size; i < ORUW_EMPC_KEY_SIZE; i++)
+            {
+                key[i] = 0;
+            }
+            for (int i = steps_num * ORUW_EMPC_STEP_SIZE; i < ORUW_EMPC_PARAMS_NUM; i++)
+            {
+                params[i] = 0.0;
+            }
+
+            // FNV-1a
+            hash = 2166136261u;
+            const unsigned char *bytes = (const unsigned char *) key;
+            for (unsigned int j = 0; j < (unsigned int) key_size * sizeof(int); j++)
+            {
+                hash = (hash ^ bytes[j]) * 16777619u;
+            }
+            return (true);
+        }
+
+
+        /// the rounded structure, the unused values are 0
+        int key[ORUW_EMPC_KEY_SIZE];
+        int key_size;
+        /// FNV-1a hash of the key
+        unsigned int hash;
+        double origin_x;
+        double origin_y;
+
+        int steps_num;
+        /// index of the sample following the last sample of each step
+        int step_end[ORUW_EMPC_STEPS_NUM];
+        /// position relative to the origin and orientation of each step
+        double params[ORUW_EMPC_PARAMS_NUM];
+
+
+    private:
+        void addKeyValue (const double value)
+        {
+            key[key_size++] = (int) floor (value / ORUW_EMPC_QUANTUM + 0.5);
+        }
+};
+
+
+
+/**
+ * @brief An affine control law, which is valid for one structure of the
+ * MPC problem in a box around the nominal initial state and the nominal
+ * parameters of the steps:
+ * state[k] = nominal_state[k]
+ *          + state_gain[k] * (init_state - nominal_init_state)
+ *          + param_gain[k] * (params - nominal_params).
+ *
+ * The positions are given relatively to the origin of the problem.
+ */
+class oruw_empc_law
+{
+    public:
+        /// hash of the structure of the problem
+        unsigned int hash;
+        /// the structure of the problem (oruw_empc_problem::key)
+        int key[ORUW_EMPC_KEY_SIZE];
+
+        float init_state[ORUW_EMPC_STATE_SIZE];
+        float params[ORUW_EMPC_PARAMS_NUM];
+        /// half-widths of the box, in which the law is valid
+        float state_range[ORUW_EMPC_STATE_SIZE];
+        float param_range[ORUW_EMPC_PARAMS_NUM];
+
+        /// the solution for the nominal initial state and parameters
+        float state[ORUW_EMPC_STATES_NUM][ORUW_EMPC_STATE_SIZE];
+        float state_gain[ORUW_EMPC_STATES_NUM][ORUW_EMPC_STATE_SIZE][ORUW_EMPC_STATE_SIZE];
+        float param_gain[ORUW_EMPC_STATES_NUM][ORUW_EMPC_STATE_SIZE][ORUW_EMPC_PARAMS_NUM];
+
+
+        bool operator< (const oruw_empc_law &law) const
+        {
+            return (hash < law.hash);
+        }
+
+
+        /**
+         * @return true if the law is built for the structure of the problem.
+         */
+        bool matches (const oruw_empc_problem &problem) const
+        {
+            return ((hash == problem.hash)
+                    && (memcmp (key, problem.key, sizeof(key)) == 0));
+        }
+};
+
+
+
+/**
+ * @brief Parameters of the MPC problem, which are not included in the
+ * hash of the structure.
+ */
+class oruw_empc_header
+{
+    public:
+        char magic[8];
+        int version;
+        int preview_window_size;
+        int states_num;
+        int steps_num;
+        float hCoM;
+        float gain_position;
+        float gain_velocity;
+        float gain_acceleration;
+        float gain_jerk;
+        int laws_num;
+};
+
+
+
+/**
+ * @brief A table of explicit MPC control laws. The table is built offline
+ * by test/empc_table.cpp and stored as a binary file (the header followed
+ * by the laws sorted by their hashes), the laws are found by binary search.
+ *
+ * @attention The file is not portable between architectures with
+ * different endianness or alignment.
+ */
+class oruw_empc_table
+{
+    public:
+        oruw_empc_table()
+        {
+            memset (&header, 0, sizeof(header));
+            memcpy (header.magic, "ORUWEMPC", sizeof(header.magic));
+            header.version = ORUW_EMPC_VERSION;
+            header.states_num = ORUW_EMPC_STATES_NUM;
+            header.steps_num = ORUW_EMPC_STEPS_NUM;
+        }
+
+
+        /**
+         * @brief Load the table.
+         *
+         * @param[in] filename name of the file
+         *
+         * @return false if the file cannot be read or has a wrong format.
+         */
+        bool load (const char *filename)
+        {
+            laws.clear();
+
+            FILE *file = fopen (filename, "rb");
+            if (file == NULL)
+            {
+                return (false);
+            }
+
+            oruw_empc_header file_header;
+            bool result = (fread (&file_header, sizeof(file_header), 1, file) == 1)
+                && (memcmp (file_header.magic, header.magic, sizeof(header.magic)) == 0)
+                && (file_header.version == ORUW_EMPC_VERSION)
+                && (file_header.states_num == ORUW_EMPC_STATES_NUM)
+                && (file_header.steps_num == ORUW_EMPC_STEPS_NUM)
+                && (file_header.laws_num >= 0);
+
+            if (result)
+            {
+                header = file_header;
+                laws.resize (header.laws_num);
+                if ((header.laws_num > 0)
+                        && (fread (&laws[0], sizeof(oruw_empc_law), header.laws_num, file)
+                            != (size_t) header.laws_num))
+                {
+                    laws.clear();
+                    result = false;
+                }
+            }
+            fclose (file);
+            return (result);
+        }
+
+
+        /**
+         * @brief Save the table.
+         *
+         * @param[in] filename name of the file
+         *
+         * @return false if the file cannot be written.
+         */
+        bool save (const char *filename)
+        {
+            FILE *file = fopen (filename, "wb");
+            if (file == NULL)
+            {
+                return (false);
+            }
+
+            sort (laws.begin(), laws.end());
+            header.laws_num = laws.size();
+
+            bool result = (fwrite (&header, sizeof(header), 1, file) == 1);
+            if (result && (header.laws_num > 0))
+            {
+                result = (fwrite (&laws[0], sizeof(oruw_empc_law), header.laws_num, file)
+                        == (size_t) header.laws_num);
+            }
+            return ((fclose (file) == 0) && result);
+        }
+
+
+        /**
+         * @brief Find a law, the hash is used for the search, the whole
+         * structure for the comparison.
+         *
+         * @param[in] problem the problem
+         *
+         * @return the law or NULL.
+         *
+         * @attention The laws must be sorted.
+         */
+        const oruw_empc_law * find (const oruw_empc_problem &problem) const
+        {
+            oruw_empc_law key;
+            key.hash = problem.hash;
+
+            for (std::vector<oruw_empc_law>::const_iterator it =
+                        lower_bound (laws.begin(), laws.end(), key);
+                    (it != laws.end()) && (it->hash == problem.hash);
+                    ++it)
+            {
+                if (it->matches (problem))
+                {
+                    return (&(*it));
+                }
+            }
+            return (NULL);
+        }
+
+
+        /**
+         * @brief Evaluate a law.
+         *
+         * @param[in] law the law
+         * @param[in] problem the problem
+         * @param[in] init_state the initial state
+         * @param[out] states ORUW_EMPC_STATES_NUM states of the solution
+         *
+         * @return false if the initial state or the parameters of the steps
+         * are outside of the box, where the law is valid.
+         */
+        static bool evaluate (
+                const oruw_empc_law &law,
+                const oruw_empc_problem &problem,
+                const smpc::state_com &init_state,
+                smpc::state_com *states)
+        {
+            double state_diff[ORUW_EMPC_STATE_SIZE];
+            for (int i = 0; i < ORUW_EMPC_STATE_SIZE; i++)
+            {
+                state_diff[i] = init_state.state_vector[i] - law.init_state[i];
+            }
+            state_diff[0] -= problem.origin_x;
+            state_diff[3] -= problem.origin_y;
+
+            for (int i = 0; i < ORUW_EMPC_STATE_SIZE; i++)
+            {
+                if (fabs (state_diff[i]) > law.state_range[i])
+                {
+                    return (false);
+                }
+            }
+
+
+            double param_diff[ORUW_EMPC_PARAMS_NUM];
+            for (int i = 0; i < ORUW_EMPC_PARAMS_NUM; i++)
+            {
+                param_diff[i] = problem.params[i] - law.params[i];
+                if (fabs (param_diff[i]) > law.param_range[i])
+                {
+                    return (false);
+                }
+            }
+
+
+            for (int k = 0; k < ORUW_EMPC_STATES_NUM; k++)
+            {
+                for (int i = 0; i < ORUW_EMPC_STATE_SIZE; i++)
+                {
+                    double value = law.state[k][i];
+                    for (int j = 0; j < ORUW_EMPC_STATE_SIZE; j++)
+                    {
+                        value += law.state_gain[k][i][j] * state_diff[j];
+                    }
+                    for (int j = 0; j < ORUW_EMPC_PARAMS_NUM; j++)
+                    {
+                        value += law.param_gain[k][i][j] * param_diff[j];
+                    }
+                    states[k].state_vector[i] = value;
+                }
+                states[k].state_vector[0] += problem.origin_x;
+                states[k].state_vector[3] += problem.origin_y;
+            }
+            return (true);
+        }
+
+
+        /**
+         * @brief Check, that the ZMPs of the states satisfy the bounds of
+         * the problem. A law is checked offline only at a few points of its
+         * box, while the active set may change inside of the box.
+         *
+         * @param[in] mpc MPC parameters
+         * @param[in] states ORUW_EMPC_STATES_NUM states of the solution
+         *
+         * @return false if a bound is violated.
+         */
+        static bool checkBounds (
+                const smpc_parameters &mpc,
+                const smpc::state_com *states)
+        {
+            for (int k = 0; k < ORUW_EMPC_STATES_NUM; k++)
+            {
+                // the ZMP relative to the foot
+                const double zmp_x = states[k].state_vector[0] - mpc.h[k] * states[k].state_vector[2] - mpc.fp_x[k];
+                const double zmp_y = states[k].state_vector[3] - mpc.h[k] * states[k].state_vector[5] - mpc.fp_y[k];
+
+                // in the frame of the foot
+                const double cos_a = cos (mpc.angle[k]);
+                const double sin_a = sin (mpc.angle[k]);
+                const double foot_zmp_x =  cos_a * zmp_x + sin_a * zmp_y;
+                const double foot_zmp_y = -sin_a * zmp_x + cos_a * zmp_y;
+
+                if ((foot_zmp_x < mpc.lb[2*k] - ORUW_EMPC_BOUNDS_TOLERANCE)
+                        || (foot_zmp_y < mpc.lb[2*k + 1] - ORUW_EMPC_BOUNDS_TOLERANCE)
+                        || (foot_zmp_x > mpc.ub[2*k] + ORUW_EMPC_BOUNDS_TOLERANCE)
+                        || (foot_zmp_y > mpc.ub[2*k + 1] + ORUW_EMPC_BOUNDS_TOLERANCE))
+                {
+                    return (false);
+                }
+            }
+            return (true);
+        }
+
+
+        oruw_empc_header header;
+        std::vector<oruw_empc_law> laws;
+};
+
+#endif // ORUW_EMPC_TABLE_H
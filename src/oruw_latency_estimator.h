@@ -0,0 +1,292 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef ORUW_LATENCY_ESTIMATOR_H
+#define ORUW_LATENCY_ESTIMATOR_H
+
+
+#include <cmath> // sqrt
+#include <climits> // INT_MIN
+
+#include "sensor_snapshot.h"
+#include "nao_igm.h"
+
+
+/// the maximal number of candidate latencies
+#define ORUW_LATENCY_MAX_LAGS 16
+/// the maximal number of commands waiting for the sensor data
+#define ORUW_LATENCY_MAX_PENDING 32
+/// forgetting factor of the correlation sums
+#define ORUW_LATENCY_FORGETTING 0.99
+/// the number of commands processed before the estimate is trusted
+#define ORUW_LATENCY_MIN_SAMPLES 50
+
+
+/**
+ * @brief Online estimation of the latency between the commands sent to the
+ * joints of the lower body and the sensor readings, which reflect them.
+ *
+ * The increments of the commanded angles are correlated with the
+ * increments of the sensed angles shifted by a set of candidate latencies
+ * (multiples of the DCM period). The normalized correlation sums are
+ * updated with exponential forgetting, the candidate with the maximal
+ * correlation is refined with a parabola through its neighbours. The peak
+ * value of the correlation is used as the confidence of the estimate.
+ *
+ * The storage is preallocated, no memory is allocated after init().
+ */
+class oruw_latency_estimator
+{
+    public:
+        /**
+         * @brief Drop all data and set the candidate latencies.
+         *
+         * @param[in] step_ms the interval between the candidates (the DCM period)
+         * @param[in] max_latency_ms the maximal latency
+         */
+        void init (const int step_ms, const int max_latency_ms)
+        {
+            this->step_ms = step_ms;
+            lags_num = max_latency_ms / step_ms + 1;
+            if (lags_num > ORUW_LATENCY_MAX_LAGS)
+            {
+                lags_num = ORUW_LATENCY_MAX_LAGS;
+            }
+
+            for (int k = 0; k < lags_num; k++)
+            {
+                sum_xy[k] = 0.0;
+                sum_yy[k] = 0.0;
+            }
+            sum_xx = 0.0;
+
+            pending_num = 0;
+            processed_num = 0;
+            last_queued_time_ms = INT_MIN;
+
+            latency_ms = 0.0;
+            confidence = 0.0;
+        }
+
+
+        /**
+         * @brief Queue a command, it is processed, when the sensor data for
+         * all candidate latencies is available. Only one command per DCM
+         * time is used: the commands, which are not later than the last
+         * queued command, are ignored.
+         *
+         * @param[in] dcm_time_ms the DCM time, when the angles must be reached
+         * @param[in] joint_state the commanded angles
+         */
+        void addCommand (const int dcm_time_ms, const jointState &joint_state)
+        {
+            if (dcm_time_ms <= last_queued_time_ms)
+            {
+                return;
+            }
+            last_queued_time_ms = dcm_time_ms;
+
+            if (pending_num == ORUW_LATENCY_MAX_PENDING)
+            {
+                // the sensor data is not coming, drop the oldest command
+                dropCommand();
+            }
+
+            pendingCommand &command = pending[pending_num];
+            command.dcm_time_ms = dcm_time_ms;
+            for (int i = 0; i < LOWER_JOINTS_NUM; i++)
+            {
+                command.q[i] = joint_state.q[i];
+            }
+            ++pending_num;
+        }
+
+
+        /**
+         * @brief Process the queued commands using the sensor data.
+         *
+         * @tparam t_history a history of the sensor data (oruw_sensor_history)
+         *
+         * @param[in] history the history
+         *
+         * @return true if the estimate was updated.
+         */
+        template <class t_history>
+        bool update (const t_history &history)
+        {
+            bool updated = false;
+
+            int latest_time_ms;
+            if (!history.getLatestTime (latest_time_ms))
+            {
+                return (false);
+            }
+
+            while ((pending_num > 0)
+                    && (pending[0].dcm_time_ms + (lags_num - 1) * step_ms <= latest_time_ms))
+            {
+                if (processCommand (history))
+                {
+                    updated = true;
+                }
+                dropCommand();
+            }
+
+            if (updated && (processed_num >= ORUW_LATENCY_MIN_SAMPLES))
+            {
+                estimate();
+            }
+
+            return (updated);
+        }
+
+
+        /// the estimated latency (ms)
+        double latency_ms;
+        /// the normalized correlation at the estimated latency [0;1]
+        double confidence;
+
+
+    private:
+        /**
+         * @brief A command waiting for the sensor data.
+         */
+        class pendingCommand
+        {
+            public:
+                int dcm_time_ms;
+                double q[LOWER_JOINTS_NUM];
+        };
+
+
+        void dropCommand ()
+        {
+            for (int j = 1; j < pending_num; j++)
+            {
+                pending[j - 1] = pending[j];
+            }
+            --pending_num;
+        }
+
+
+        /**
+         * @brief Update the correlation sums with the increments between
+         * the previous and the oldest pending commands.
+         *
+         * @return false if the sensor data is not available.
+         */
+        template <class t_history>
+        bool processCommand (const t_history &history)
+        {
+            const pendingCommand &command = pending[0];
+
+            for (int k = 0; k < lags_num; k++)
+            {
+                if (!history.getSnapshot (command.dcm_time_ms + k * step_ms, sensors))
+                {
+                    processed_num = 0;
+                    return (false);
+                }
+                for (int i = 0; i < LOWER_JOINTS_NUM; i++)
+                {
+                    sensed_q[k][i] = sensors.values[i];
+                }
+            }
+
+
+            bool updated = false;
+            if (processed_num > 0)
+            {
+                sum_xx *= ORUW_LATENCY_FORGETTING;
+                for (int k = 0; k < lags_num; k++)
+                {
+                    sum_xy[k] *= ORUW_LATENCY_FORGETTING;
+                    sum_yy[k] *= ORUW_LATENCY_FORGETTING;
+                }
+
+                for (int i = 0; i < LOWER_JOINTS_NUM; i++)
+                {
+                    const double dx = command.q[i] - last_command.q[i];
+                    sum_xx += dx * dx;
+                    for (int k = 0; k < lags_num; k++)
+                    {
+                        const double dy = sensed_q[k][i] - last_sensed_q[k][i];
+                        sum_xy[k] += dx * dy;
+                        sum_yy[k] += dy * dy;
+                    }
+                }
+                updated = true;
+            }
+
+
+            last_command = command;
+            for (int k = 0; k < lags_num; k++)
+            {
+                for (int i = 0; i < LOWER_JOINTS_NUM; i++)
+                {
+                    last_sensed_q[k][i] = sensed_q[k][i];
+                }
+            }
+            ++processed_num;
+
+            return (updated);
+        }
+
+
+        /**
+         * @brief Find the peak of the normalized correlation.
+         */
+        void estimate ()
+        {
+            double correlation[ORUW_LATENCY_MAX_LAGS];
+            int peak = 0;
+
+            for (int k = 0; k < lags_num; k++)
+            {
+                const double norm = sqrt (sum_xx * sum_yy[k]);
+                correlation[k] = (norm > 0.0) ? sum_xy[k] / norm : 0.0;
+                if (correlation[k] > correlation[peak])
+                {
+                    peak = k;
+                }
+            }
+
+
+            double offset = 0.0;
+            if ((peak > 0) && (peak < lags_num - 1))
+            {
+                const double curvature = correlation[peak - 1] - 2 * correlation[peak] + correlation[peak + 1];
+                if (curvature < 0.0)
+                {
+                    offset = 0.5 * (correlation[peak - 1] - correlation[peak + 1]) / curvature;
+                }
+            }
+
+            latency_ms = (peak + offset) * step_ms;
+            confidence = (correlation[peak] > 0.0) ? correlation[peak] : 0.0;
+        }
+
+
+        int step_ms;
+        int lags_num;
+
+        double sum_xx;
+        double sum_xy[ORUW_LATENCY_MAX_LAGS];
+        double sum_yy[ORUW_LATENCY_MAX_LAGS];
+
+        pendingCommand pending[ORUW_LATENCY_MAX_PENDING];
+        int pending_num;
+        int processed_num;
+        /// the DCM time of the last queued command
+        int last_queued_time_ms;
+
+        pendingCommand last_command;
+        double sensed_q[ORUW_LATENCY_MAX_LAGS][LOWER_JOINTS_NUM];
+        double last_sensed_q[ORUW_LATENCY_MAX_LAGS][LOWER_JOINTS_NUM];
+        sensorSnapshot sensors;
+};
+
+#endif // ORUW_LATENCY_ESTIMATOR_H
@@ -17,6 +17,8 @@ oruw_log::oruw_log ()
     FJointsLog = fopen ("./oru_joints.log", "w");
     FCoMLog = fopen ("./oru_com.log", "w");
     FFeetLog = fopen ("./oru_feet.log", "w");
+    FSensorsLog = fopen ("./oru_sensors.log", "w");
+    FShadowLog = fopen ("./oru_shadow.log", "w");
     FMessages = fopen ("./oru_messages.log", "w");
 }
 
@@ -26,6 +28,8 @@ oruw_log::~oruw_log ()
     fclose (FJointsLog);
     fclose (FCoMLog);
     fclose (FFeetLog);
+    fclose (FSensorsLog);
+    fclose (FShadowLog);
     fclose (FMessages);
 }
 
@@ -85,6 +89,17 @@ void oruw_log::logFeet(nao_igm& nao)
 }
 
 
+void oruw_log::logSensors(const sensorSnapshot& sensors)
+{
+    fprintf (FSensorsLog, "%d    ", sensors.dcm_time_ms);
+    for (int i = JOINTS_NUM; i < SENSORS_NUM; i++)
+    {
+        fprintf (FSensorsLog, "%f ", sensors.values[i]);
+    }
+    fprintf (FSensorsLog, "\n");
+}
+
+
 void oruw_log::logSolverInfo (smpc::solver *solver, int mpc_solver_type)
 {
     if (solver != NULL)
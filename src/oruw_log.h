@@ -23,6 +23,7 @@
 #include "WMG.h"
 #include "joints_sensors_id.h"
 #include "walk_parameters.h"
+#include "sensor_snapshot.h"
 
 
 class oruw_log
@@ -35,11 +36,14 @@ class oruw_log
         void logCoM (smpc_parameters&, nao_igm&);
         void logFeet (nao_igm& nao);
         void logSolverInfo (smpc::solver *, int);
+        void logSensors (const sensorSnapshot&);
 
 
         FILE *FJointsLog;
         FILE *FCoMLog;
         FILE *FFeetLog;
+        FILE *FSensorsLog;
+        FILE *FShadowLog;
         FILE *FMessages;
 };
 
@@ -62,9 +66,15 @@ extern oruw_log *oruw_log_instance;
 #define ORUW_LOG_FEET(nao) \
     if ORUW_LOG_IS_OPEN {oruw_log_instance->logFeet(nao);}
 
+#define ORUW_LOG_SENSORS(sensors) \
+    if ORUW_LOG_IS_OPEN {oruw_log_instance->logSensors(sensors);}
+
 #define ORUW_LOG_MESSAGE(...) \
     if ORUW_LOG_IS_OPEN {fprintf(oruw_log_instance->FMessages, __VA_ARGS__);}
 
+#define ORUW_LOG_SHADOW(...) \
+    if ORUW_LOG_IS_OPEN {fprintf(oruw_log_instance->FShadowLog, __VA_ARGS__);}
+
 #define ORUW_LOG_SOLVER_INFO \
     if ORUW_LOG_IS_OPEN {oruw_log_instance->logSolverInfo(solver, wp.mpc_solver_type);}
 
@@ -80,7 +90,9 @@ extern oruw_log *oruw_log_instance;
 #define ORUW_LOG_JOINTS(sensors,actuators)
 #define ORUW_LOG_COM(mpc,nao)
 #define ORUW_LOG_FEET(nao)
+#define ORUW_LOG_SENSORS(sensors)
 #define ORUW_LOG_MESSAGE(...)
+#define ORUW_LOG_SHADOW(...)
 #define ORUW_LOG_STEPS(wmg)
 #define ORUW_LOG_SOLVER_INFO
 
@@ -0,0 +1,96 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef ORUW_PERCENTILE_WINDOW_H
+#define ORUW_PERCENTILE_WINDOW_H
+
+
+#include <algorithm> // nth_element
+
+
+/**
+ * @brief A sliding window of measurements with percentile queries.
+ *
+ * The storage is preallocated, hence no memory is allocated when
+ * measurements are added or percentiles are computed.
+ */
+template <int size>
+class oruw_percentile_window
+{
+    public:
+        oruw_percentile_window()
+        {
+            reset();
+        }
+
+
+        /**
+         * @brief Drop all measurements.
+         */
+        void reset()
+        {
+            num = 0;
+            next = 0;
+        }
+
+
+        /**
+         * @brief Add a measurement, the oldest one is dropped if the
+         * window is full.
+         *
+         * @param[in] value the measurement
+         */
+        void add(const double value)
+        {
+            values[next] = value;
+            next = (next + 1) % size;
+            if (num < size)
+            {
+                ++num;
+            }
+        }
+
+
+        /**
+         * @return true if the window is full.
+         */
+        bool isFull() const
+        {
+            return (num == size);
+        }
+
+
+        /**
+         * @brief Compute a percentile of the measurements in the window.
+         *
+         * @param[in] p percentile in the range [0, 1].
+         *
+         * @return the value of the percentile or 0 if the window is empty.
+         */
+        double getPercentile(const double p)
+        {
+            if (num == 0)
+            {
+                return (0.0);
+            }
+
+            int index = (int) (p * (num - 1) + 0.5);
+            std::copy (values, values + num, sorted);
+            std::nth_element (sorted, sorted + index, sorted + num);
+            return (sorted[index]);
+        }
+
+
+    private:
+        double values[size];
+        /// a buffer used in computation of percentiles
+        double sorted[size];
+
+        int num;
+        int next;
+};
+
+#endif // ORUW_PERCENTILE_WINDOW_H
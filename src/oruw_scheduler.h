@@ -0,0 +1,147 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef ORUW_SCHEDULER_H
+#define ORUW_SCHEDULER_H
+
+#include <time.h> // clock_nanosleep, clock_gettime
+#include <errno.h>
+
+#include "oruw_log.h"
+
+
+/**
+ * @brief Periodic scheduler, which sleeps until absolute deadlines on
+ * CLOCK_MONOTONIC. The deadlines are phase-locked to the DCM time.
+ */
+class oruw_scheduler
+{
+    public:
+        /**
+         * @brief Start a new sequence of deadlines.
+         *
+         * @param[in] period_ms period
+         * @param[in] wakeup_offset_ms the deadlines are shifted with respect
+         *  to the DCM cycles by this value.
+         * @param[in] dcm_time_ms current DCM time
+         */
+        void start(
+                const int period_ms,
+                const int wakeup_offset_ms,
+                const int dcm_time_ms)
+        {
+            period = period_ms;
+            next_deadline_dcm = dcm_time_ms + period_ms + wakeup_offset_ms;
+            dcm_offset = getMonotonicTimeMs() - dcm_time_ms;
+
+            ticks_num = 0;
+            missed_periods_num = 0;
+            last_jitter_ms = 0.0;
+            max_jitter_ms = 0.0;
+            sum_jitter_ms = 0.0;
+        }
+
+
+        /**
+         * @brief Sleep until the next deadline.
+         *
+         * @param[in] dcm_time_ms current DCM time
+         *
+         * @return number of periods, that were missed since the last call.
+         */
+        int wait(const int dcm_time_ms)
+        {
+            updateOffset (dcm_time_ms);
+
+            timespec deadline;
+            double deadline_ms = next_deadline_dcm + dcm_offset;
+            deadline.tv_sec = (time_t) (deadline_ms / 1000);
+            deadline.tv_nsec = (long) ((deadline_ms - (double) deadline.tv_sec * 1000) * 1000000);
+            while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR);
+
+
+            last_jitter_ms = getMonotonicTimeMs() - deadline_ms;
+
+            // the thread was woken up too late, skip the missed deadlines
+            int missed_periods = (int) (last_jitter_ms / period);
+            missed_periods_num += missed_periods;
+            next_deadline_dcm += (missed_periods + 1) * period;
+
+            ++ticks_num;
+            sum_jitter_ms += last_jitter_ms;
+            if (last_jitter_ms > max_jitter_ms)
+            {
+                max_jitter_ms = last_jitter_ms;
+            }
+
+            return (missed_periods);
+        }
+
+
+        /**
+         * @brief Log statistics.
+         */
+        void log()
+        {
+            ORUW_LOG_MESSAGE("Scheduler: ticks = %d // missed periods = %d // jitter: mean = %f ms, max = %f ms\n",
+                    ticks_num,
+                    missed_periods_num,
+                    (ticks_num > 0) ? sum_jitter_ms / ticks_num : 0.0,
+                    max_jitter_ms);
+        }
+
+
+        /**
+         * @return the value of CLOCK_MONOTONIC in milliseconds
+         */
+        static double getMonotonicTimeMs()
+        {
+            timespec now;
+            clock_gettime (CLOCK_MONOTONIC, &now);
+            return ((double) now.tv_sec * 1000 + (double) now.tv_nsec / 1000000);
+        }
+
+
+        /// number of calls to wait()
+        int ticks_num;
+        /// total number of missed periods
+        int missed_periods_num;
+        /// the difference between the actual wake up time and the deadline
+        double last_jitter_ms;
+        double max_jitter_ms;
+        double sum_jitter_ms;
+
+
+    private:
+
+
+        /**
+         * @brief Track the offset between the DCM time and the monotonic
+         * clock. The DCM time is observed with a delay, hence the lower
+         * envelope of the differences is used; the envelope is slowly
+         * raised to follow the drift of the clocks.
+         *
+         * @param[in] dcm_time_ms current DCM time
+         */
+        void updateOffset(const int dcm_time_ms)
+        {
+            double offset = getMonotonicTimeMs() - dcm_time_ms;
+            dcm_offset += 0.005; // ms per call
+            if (offset < dcm_offset)
+            {
+                dcm_offset = offset;
+            }
+        }
+
+
+        int period;
+        /// the next deadline in the DCM time
+        double next_deadline_dcm;
+        /// monotonic time - DCM time
+        double dcm_offset;
+};
+
+#endif // ORUW_SCHEDULER_H
@@ -0,0 +1,247 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef ORUW_SENSOR_HISTORY_H
+#define ORUW_SENSOR_HISTORY_H
+
+
+#include "sensor_snapshot.h"
+
+
+/**
+ * @brief A lock-free ring buffer of sensor snapshots tagged with the DCM
+ * time, which is filled in every cycle of the DCM and allows to get the
+ * sensor data at an arbitrary moment of time.
+ *
+ * Each slot is protected by a sequence counter: the writer makes it odd
+ * while the slot is being filled, the reader retries, if the counter was
+ * odd or changed during copying. The writer is never blocked.
+ *
+ * @attention Only one writer is allowed, the number of readers is not limited.
+ *
+ * @tparam size the number of slots, one of them is always reserved for
+ * the writer.
+ */
+template <int size>
+class oruw_sensor_history
+{
+    public:
+        oruw_sensor_history()
+        {
+            reset();
+        }
+
+
+        /**
+         * @brief Drop the data, must not be called concurrently with other
+         * methods.
+         */
+        void reset()
+        {
+            for (int i = 0; i < size; i++)
+            {
+                slots[i].sequence = 0;
+            }
+            published_num = 0;
+            write_index = 0;
+        }
+
+
+        /**
+         * @return the slot, which must be filled by the writer.
+         */
+        sensorSnapshot& getWriteSlot()
+        {
+            write_index = published_num % size;
+            ++slots[write_index].sequence;
+            __sync_synchronize();
+            return (slots[write_index].snapshot);
+        }
+
+
+        /**
+         * @brief Make the content of the write slot available to the reader.
+         */
+        void publish()
+        {
+            __sync_synchronize();
+            ++slots[write_index].sequence;
+            __sync_synchronize();
+            ++published_num;
+        }
+
+
+        /**
+         * @brief Get the sensor data at the given moment of time. The
+         * values are linearly interpolated between the nearest samples, or
+         * extrapolated using the two latest samples, if the time is in the
+         * future.
+         *
+         * @param[in] dcm_time_ms the DCM time
+         * @param[out] result the sensor data
+         *
+         * @return false if there is no data or the time is older than the
+         * history.
+         */
+        bool getSnapshot (const int dcm_time_ms, sensorSnapshot &result) const
+        {
+            const int written_num = published_num;
+            __sync_synchronize();
+
+            if (written_num == 0)
+            {
+                return (false);
+            }
+            const int available_num = (written_num < size) ? written_num : size - 1;
+
+            sensorSnapshot earlier;
+            sensorSnapshot later;
+
+
+            int index = (written_num - 1) % size;
+            if (!copySlot (index, later))
+            {
+                return (false);
+            }
+            if (available_num == 1)
+            {
+                result = later;
+                return (true);
+            }
+
+            for (int i = 1; ; i++)
+            {
+                index = (index + size - 1) % size;
+                if (!copySlot (index, earlier))
+                {
+                    return (false);
+                }
+
+                if (earlier.dcm_time_ms <= dcm_time_ms)
+                {
+                    break;
+                }
+
+                if (i == available_num - 1)
+                {
+                    return (false);
+                }
+                later = earlier;
+            }
+
+            interpolate (earlier, later, dcm_time_ms, result);
+            return (true);
+        }
+
+
+        /**
+         * @brief Get the time of the latest sensor data.
+         *
+         * @param[out] dcm_time_ms the DCM time
+         *
+         * @return false if there is no data.
+         */
+        bool getLatestTime (int &dcm_time_ms) const
+        {
+            const int written_num = published_num;
+            __sync_synchronize();
+
+            sensorSnapshot latest;
+            if ((written_num == 0) || !copySlot ((written_num - 1) % size, latest))
+            {
+                return (false);
+            }
+            dcm_time_ms = latest.dcm_time_ms;
+            return (true);
+        }
+
+
+    private:
+        /**
+         * @brief A snapshot with its sequence counter.
+         */
+        class slot
+        {
+            public:
+                volatile int sequence;
+                sensorSnapshot snapshot;
+        };
+
+
+        /**
+         * @brief Copy a slot, which may be concurrently overwritten.
+         *
+         * @param[in] index index of the slot
+         * @param[out] copy the copy
+         *
+         * @return false if the slot was being overwritten during all attempts.
+         */
+        bool copySlot (const int index, sensorSnapshot &copy) const
+        {
+            for (int attempt = 0; attempt < ORUW_SENSOR_HISTORY_ATTEMPTS; attempt++)
+            {
+                const int sequence = slots[index].sequence;
+                __sync_synchronize();
+                if ((sequence & 1) == 0)
+                {
+                    copy = slots[index].snapshot;
+                    __sync_synchronize();
+                    if (sequence == slots[index].sequence)
+                    {
+                        return (true);
+                    }
+                }
+            }
+            return (false);
+        }
+
+
+        /**
+         * @brief Interpolate between two snapshots.
+         *
+         * @param[in] earlier the earlier snapshot
+         * @param[in] later the later snapshot
+         * @param[in] dcm_time_ms the DCM time
+         * @param[out] result the sensor data
+         */
+        void interpolate (
+                const sensorSnapshot &earlier,
+                const sensorSnapshot &later,
+                const int dcm_time_ms,
+                sensorSnapshot &result) const
+        {
+            result.dcm_time_ms = dcm_time_ms;
+
+            const int interval_ms = later.dcm_time_ms - earlier.dcm_time_ms;
+            if (interval_ms <= 0)
+            {
+                for (int i = 0; i < SENSORS_NUM; i++)
+                {
+                    result.values[i] = later.values[i];
+                }
+                return;
+            }
+
+            const float ratio = (float) (dcm_time_ms - earlier.dcm_time_ms) / interval_ms;
+            for (int i = 0; i < SENSORS_NUM; i++)
+            {
+                result.values[i] = earlier.values[i] + (later.values[i] - earlier.values[i]) * ratio;
+            }
+        }
+
+
+        enum
+        {
+            ORUW_SENSOR_HISTORY_ATTEMPTS = 4
+        };
+
+
+        slot slots[size];
+        volatile int published_num;
+        int write_index;
+};
+
+#endif // ORUW_SENSOR_HISTORY_H
@@ -0,0 +1,213 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef ORUW_SOLVER_CACHE_H
+#define ORUW_SOLVER_CACHE_H
+
+
+#include <cstring> // memcpy
+
+#include "smpc_solver.h"
+
+
+/// the number of cached solvers, all solvers of one walk must fit in the
+/// cache: the ladder, the shorter preview windows and the shadow solver
+#define ORUW_SOLVER_CACHE_SIZE 8
+/// the maximal number of parameters of a solver
+#define ORUW_SOLVER_KEY_SIZE 16
+
+
+/**
+ * @brief Parameters of a solver, which are passed to its constructor.
+ */
+class oruw_solver_key
+{
+    public:
+        oruw_solver_key()
+        {
+            size = 0;
+        }
+
+
+        /**
+         * @brief Append a parameter.
+         *
+         * @param[in] value the value of the parameter
+         */
+        void add (const double value)
+        {
+            values[size] = value;
+            ++size;
+        }
+
+
+        /**
+         * @return FNV-1a hash of the parameters.
+         */
+        unsigned int hash () const
+        {
+            unsigned int result = 2166136261u;
+            for (int i = 0; i < size; i++)
+            {
+                unsigned char bytes[sizeof(double)];
+                memcpy (bytes, &values[i], sizeof(double));
+                for (unsigned int j = 0; j < sizeof(double); j++)
+                {
+                    result = (result ^ bytes[j]) * 16777619u;
+                }
+            }
+            return (result);
+        }
+
+
+        bool operator== (const oruw_solver_key &key) const
+        {
+            if (size != key.size)
+            {
+                return (false);
+            }
+            for (int i = 0; i < size; i++)
+            {
+                if (values[i] != key.values[i])
+                {
+                    return (false);
+                }
+            }
+            return (true);
+        }
+
+
+    private:
+        double values[ORUW_SOLVER_KEY_SIZE];
+        int size;
+};
+
+
+
+/**
+ * @brief A cache of constructed solvers, which allows to reuse their
+ * matrices and workspaces, when the parameters do not change. The least
+ * recently used solver is deleted, when the cache is full.
+ *
+ * The cache owns the solvers.
+ */
+class oruw_solver_cache
+{
+    public:
+        oruw_solver_cache()
+        {
+            for (int i = 0; i < ORUW_SOLVER_CACHE_SIZE; i++)
+            {
+                entries[i].solver = NULL;
+            }
+            use_counter = 0;
+            hits_num = 0;
+            misses_num = 0;
+        }
+
+
+        ~oruw_solver_cache()
+        {
+            clear();
+        }
+
+
+        /**
+         * @brief Find a solver.
+         *
+         * @param[in] key parameters of the solver
+         *
+         * @return the solver or NULL.
+         */
+        smpc::solver * find (const oruw_solver_key &key)
+        {
+            unsigned int hash = key.hash();
+            for (int i = 0; i < ORUW_SOLVER_CACHE_SIZE; i++)
+            {
+                if ((entries[i].solver != NULL)
+                        && (entries[i].hash == hash)
+                        && (entries[i].key == key))
+                {
+                    entries[i].last_use = ++use_counter;
+                    ++hits_num;
+                    return (entries[i].solver);
+                }
+            }
+            ++misses_num;
+            return (NULL);
+        }
+
+
+        /**
+         * @brief Add a solver, the least recently used solver may be
+         * deleted.
+         *
+         * @param[in] key parameters of the solver
+         * @param[in] solver the solver
+         */
+        void add (const oruw_solver_key &key, smpc::solver *solver)
+        {
+            int index = 0;
+            for (int i = 0; i < ORUW_SOLVER_CACHE_SIZE; i++)
+            {
+                if (entries[i].solver == NULL)
+                {
+                    index = i;
+                    break;
+                }
+                if (entries[i].last_use < entries[index].last_use)
+                {
+                    index = i;
+                }
+            }
+
+            if (entries[index].solver != NULL)
+            {
+                delete entries[index].solver;
+            }
+            entries[index].key = key;
+            entries[index].hash = key.hash();
+            entries[index].solver = solver;
+            entries[index].last_use = ++use_counter;
+        }
+
+
+        /**
+         * @brief Delete all solvers.
+         */
+        void clear ()
+        {
+            for (int i = 0; i < ORUW_SOLVER_CACHE_SIZE; i++)
+            {
+                if (entries[i].solver != NULL)
+                {
+                    delete entries[i].solver;
+                    entries[i].solver = NULL;
+                }
+            }
+        }
+
+
+        /// statistics
+        int hits_num;
+        int misses_num;
+
+
+    private:
+        class entry
+        {
+            public:
+                oruw_solver_key key;
+                unsigned int hash;
+                smpc::solver *solver;
+                unsigned int last_use;
+        };
+
+        entry entries[ORUW_SOLVER_CACHE_SIZE];
+        unsigned int use_counter;
+};
+
+#endif // ORUW_SOLVER_CACHE_H
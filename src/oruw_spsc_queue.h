@@ -0,0 +1,123 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef ORUW_SPSC_QUEUE_H
+#define ORUW_SPSC_QUEUE_H
+
+
+#include <cstddef> // NULL
+
+
+/**
+ * @brief A preallocated lock-free queue with one producer and one consumer.
+ *
+ * The producer fills the slot returned by getBackSlot() and calls push(),
+ * the consumer processes the element returned by getFront() and calls pop().
+ *
+ * @attention Only one producer and one consumer are allowed.
+ */
+template <class T, int capacity>
+class oruw_spsc_queue
+{
+    public:
+        oruw_spsc_queue()
+        {
+            reset();
+        }
+
+
+        /**
+         * @brief Drop all elements, must not be called concurrently
+         * with other methods.
+         */
+        void reset()
+        {
+            head = 0;
+            tail = 0;
+        }
+
+
+        /**
+         * @return a free slot at the end of the queue or NULL if the
+         * queue is full.
+         */
+        T* getBackSlot()
+        {
+            if (next(tail) == head)
+            {
+                return (NULL);
+            }
+            return (&items[tail]);
+        }
+
+
+        /**
+         * @brief Make the element filled by the producer available to the consumer.
+         */
+        void push()
+        {
+            __sync_synchronize();
+            tail = next(tail);
+        }
+
+
+        /**
+         * @return the first element in the queue or NULL if the queue is empty.
+         */
+        T* getFront()
+        {
+            if (head == tail)
+            {
+                return (NULL);
+            }
+            __sync_synchronize();
+            return (&items[head]);
+        }
+
+
+        /**
+         * @brief Remove the first element.
+         */
+        void pop()
+        {
+            __sync_synchronize();
+            head = next(head);
+        }
+
+
+        /**
+         * @return true if the queue is empty, may be called by the producer.
+         */
+        bool isEmpty() const
+        {
+            return (head == tail);
+        }
+
+
+        /**
+         * @return true if the element returned by getFront() is the last one.
+         */
+        bool isLast()
+        {
+            return (next(head) == tail);
+        }
+
+
+    private:
+        int next(const int index) const
+        {
+            return ((index + 1) % (capacity + 1));
+        }
+
+
+        /// one slot is always empty to distinguish full and empty states
+        T items[capacity + 1];
+
+        volatile int head;
+        volatile int tail;
+};
+
+#endif // ORUW_SPSC_QUEUE_H
@@ -49,14 +49,23 @@ class oruw_timer
          */
         bool check()
         {
-            qi::os::gettimeofday (&end_time);
-            double timediff = ((double) end_time.tv_sec - start_time.tv_sec 
-                            + 0.000001* (end_time.tv_usec - start_time.tv_usec));
+            double timediff = elapsed();
             ORUW_LOG_MESSAGE("Checking timer '%s': value = %f / limit = %f\n", id, timediff, limit);
             return (timediff <= limit);
         }
 
 
+        /**
+         * @return time passed since creation or the last reset (in seconds).
+         */
+        double elapsed()
+        {
+            qi::os::gettimeofday (&end_time);
+            return ((double) end_time.tv_sec - start_time.tv_sec
+                    + 0.000001* (end_time.tv_usec - start_time.tv_usec));
+        }
+
+
     private:
         qi::os::timeval end_time;
         qi::os::timeval start_time;
@@ -0,0 +1,122 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef ORUW_TRIPLE_BUFFER_H
+#define ORUW_TRIPLE_BUFFER_H
+
+
+/**
+ * @brief A wait-free triple buffer for passing data from one writer thread
+ * to one reader thread.
+ *
+ * The writer fills the slot returned by getWriteSlot() and calls publish(),
+ * the reader calls update() and uses getReadSlot(). Neither of the threads
+ * is ever blocked, the reader always gets the most recent complete data.
+ *
+ * @attention Only one writer and one reader are allowed.
+ */
+template <class T>
+class oruw_triple_buffer
+{
+    public:
+        oruw_triple_buffer()
+        {
+            reset();
+        }
+
+
+        /**
+         * @brief Drop the published data, must not be called concurrently
+         * with other methods.
+         */
+        void reset()
+        {
+            write_index = 0;
+            read_index = 1;
+            middle = 2;
+        }
+
+
+        /**
+         * @return the slot owned by the writer.
+         */
+        T& getWriteSlot()
+        {
+            return (buffers[write_index]);
+        }
+
+
+        /**
+         * @brief Make the content of the write slot available to the reader.
+         */
+        void publish()
+        {
+            write_index = exchange (write_index | FRESH_FLAG) & INDEX_MASK;
+        }
+
+
+        /**
+         * @brief Fetch the most recent published data.
+         *
+         * @return true if new data was published since the last call.
+         */
+        bool update()
+        {
+            if ((middle & FRESH_FLAG) == 0)
+            {
+                return (false);
+            }
+            read_index = exchange (read_index) & INDEX_MASK;
+            return (true);
+        }
+
+
+        /**
+         * @return the slot owned by the reader.
+         */
+        const T& getReadSlot() const
+        {
+            return (buffers[read_index]);
+        }
+
+
+    private:
+        /**
+         * @brief Atomically replace the index of the middle buffer.
+         * The builtin is a full memory barrier, i.e. the content of the
+         * buffer is visible to the other thread before the index.
+         *
+         * @param[in] new_middle new value
+         *
+         * @return old value
+         */
+        int exchange (const int new_middle)
+        {
+            int old_middle;
+            do
+            {
+                old_middle = middle;
+            }
+            while (!__sync_bool_compare_and_swap (&middle, old_middle, new_middle));
+
+            return (old_middle);
+        }
+
+
+        enum
+        {
+            INDEX_MASK = 3,
+            FRESH_FLAG = 4
+        };
+
+        T buffers[3];
+
+        int write_index;
+        int read_index;
+        volatile int middle;
+};
+
+#endif // ORUW_TRIPLE_BUFFER_H
@@ -0,0 +1,174 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef ORUW_WORKER_H
+#define ORUW_WORKER_H
+
+
+#include <semaphore.h>
+
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+
+
+/**
+ * @brief A helper thread, which executes the same job on request.
+ *
+ * The job is set once in start(), hence no memory is allocated when the
+ * job is executed. The state of the job is protected by a mutex, wait()
+ * may be called by several threads at once.
+ */
+class oruw_worker
+{
+    public:
+        oruw_worker()
+        {
+            thread = NULL;
+            busy = false;
+            failed = false;
+            sem_init (&start_sem, 0, 0);
+        }
+
+
+        ~oruw_worker()
+        {
+            stop();
+            sem_destroy (&start_sem);
+        }
+
+
+        /**
+         * @brief Spawn the thread.
+         *
+         * @param[in] worker_job the job
+         *
+         * @return the thread
+         */
+        boost::thread & start(const boost::function<void ()> &worker_job)
+        {
+            stop();
+
+            while (sem_trywait (&start_sem) == 0);
+            job = worker_job;
+            stop_requested = false;
+            {
+                boost::mutex::scoped_lock lock(mutex);
+                failed = false;
+                busy = false;
+            }
+
+            thread = new boost::thread(&oruw_worker::loop, this);
+            return (*thread);
+        }
+
+
+        /**
+         * @brief Terminate the thread, the current job is finished first.
+         */
+        void stop()
+        {
+            if (thread != NULL)
+            {
+                stop_requested = true;
+                sem_post (&start_sem);
+                thread->join();
+
+                delete thread;
+                thread = NULL;
+            }
+        }
+
+
+        /**
+         * @brief Execute the job once, the failure of the previous job is
+         * forgotten.
+         */
+        void post()
+        {
+            {
+                boost::mutex::scoped_lock lock(mutex);
+                failed = false;
+                busy = true;
+            }
+            sem_post (&start_sem);
+        }
+
+
+        /**
+         * @brief Wait until the job is done, all waiting threads return.
+         */
+        void wait()
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            while (busy)
+            {
+                done_condition.wait (lock);
+            }
+        }
+
+
+        /**
+         * @brief Check if the job is done without waiting. The mutex is
+         * not waited for either: the job is reported as not done, if the
+         * mutex is held by another thread.
+         *
+         * @return true if the job is done or was never posted.
+         */
+        bool isDone()
+        {
+            boost::mutex::scoped_try_lock lock(mutex);
+            return (lock.owns_lock() && !busy);
+        }
+
+
+        /// set if the last job has thrown an exception, valid after wait()
+        volatile bool failed;
+
+
+    private:
+        void loop()
+        {
+            for (;;)
+            {
+                while (sem_wait (&start_sem) != 0); // restart if interrupted
+                if (stop_requested)
+                {
+                    break;
+                }
+
+                bool job_failed = false;
+                try
+                {
+                    job();
+                }
+                catch (...)
+                {
+                    job_failed = true;
+                }
+
+                {
+                    boost::mutex::scoped_lock lock(mutex);
+                    failed = job_failed;
+                    busy = false;
+                }
+                done_condition.notify_all();
+            }
+        }
+
+
+        boost::thread *thread;
+        boost::function<void ()> job;
+
+        sem_t start_sem;
+
+        volatile bool stop_requested;
+        /// protects busy and failed
+        boost::mutex mutex;
+        boost::condition_variable done_condition;
+        bool busy;
+};
+
+#endif // ORUW_WORKER_H
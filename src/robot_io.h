@@ -0,0 +1,99 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef ROBOT_IO_H
+#define ROBOT_IO_H
+
+
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include <alvalue/alvalue.h> // ALValue
+
+
+using namespace AL;
+using namespace std;
+
+
+/**
+ * @brief An interface to the robot: sensors, actuators and the clock of
+ * the DCM. The commands have the same format as the commands of the DCM.
+ */
+class robotIO
+{
+    public:
+        virtual ~robotIO() {};
+
+
+        /**
+         * @brief Create aliases and prepare access to sensors.
+         *
+         * @param[in] joint_names names of the joints (JOINTS_NUM).
+         */
+        virtual void connect (const vector<string> &joint_names) = 0;
+
+
+        /**
+         * @brief Read all sensors in the bundle (see sensorIds) and the
+         * time of the DCM cycle, in which they were sampled.
+         *
+         * @param[out] values preallocated vector of size SENSORS_NUM.
+         * @param[out] dcm_time_ms DCM time of the last cycle (in ms).
+         */
+        virtual void readSensors (vector<float> &values, int &dcm_time_ms) = 0;
+
+
+        /**
+         * @return DCM time of the last cycle of the DCM (in ms).
+         */
+        virtual int getCycleTime () = 0;
+
+
+        /**
+         * @param[in] shift_ms shift from the current time.
+         *
+         * @return DCM time in the future (in ms).
+         */
+        virtual int getTime (const int shift_ms) = 0;
+
+
+        /**
+         * @brief Send timed commands to the actuators.
+         *
+         * @param[in] commands commands in the format of DCM::setAlias().
+         */
+        virtual void setAlias (const ALValue &commands) = 0;
+
+
+        /**
+         * @brief Change stiffness of all joints, does not wait for the end
+         * of the change.
+         *
+         * @param[in] stiffness stiffness [0;1]
+         * @param[in] change_time_ms time of the change.
+         *
+         * @return DCM time, when the change is finished (in ms).
+         */
+        virtual int setStiffness (const float stiffness, const int change_time_ms) = 0;
+
+
+        /**
+         * @brief Call the given function after each cycle of the DCM.
+         *
+         * @param[in] callback the function
+         */
+        virtual void connectCallback (const boost::function<void ()> &callback) = 0;
+
+
+        /**
+         * @brief Stop calling the callback.
+         */
+        virtual void disconnectCallback () = 0;
+};
+
+#endif // ROBOT_IO_H
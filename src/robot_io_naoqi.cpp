@@ -0,0 +1,342 @@
+/**
+ * @file
+ * @author Antonio Paolillo
+ * @author Dimitar Dimitrov
+ * @author Alexander Sherikov
+ */
+
+#include "robot_io_naoqi.h"
+#include "joints_sensors_id.h"
+#include "sensor_snapshot.h"
+#include "oruw_timer.h"
+
+
+#define ORUW_IO_THROW(message) throw ALERROR("oru_walk", __FUNCTION__, message)
+#define ORUW_IO_THROW_ERROR(message,error) throw ALERROR("oru_walk", __FUNCTION__, message + string (error.what()))
+
+
+
+/**
+ * @brief Connect to the DCM and the memory.
+ *
+ * @param[in] parent_broker the broker of the module.
+ */
+robotIONaoqi::robotIONaoqi (ALPtr<ALBroker> parent_broker) :
+    broker (parent_broker),
+    access_sensor_values (ALPtr<ALMemoryFastAccess>(new ALMemoryFastAccess()))
+{
+    // Is the DCM running? (checked, while the proxies are created)
+    boost::thread check_thread (&robotIONaoqi::checkDCM, this);
+
+
+    try
+    {
+        // Get the DCM proxy
+        dcm_proxy = broker->getDcmProxy();
+    }
+    catch (ALError& e)
+    {
+        check_thread.join();
+        ORUW_IO_THROW_ERROR("Impossible to create DCM Proxy: ", e);
+    }
+
+
+    try
+    {
+        // Get the memory proxy
+        memory_proxy = broker->getMemoryProxy();
+    }
+    catch (ALError& e)
+    {
+        check_thread.join();
+        ORUW_IO_THROW_ERROR("Impossible to create memory proxy: ", e);
+    }
+
+
+    check_thread.join();
+    if (!init_error.empty())
+    {
+        ORUW_IO_THROW(init_error);
+    }
+}
+
+
+
+/**
+ * @brief Check if the DCM is running, the error is saved in init_error.
+ */
+void robotIONaoqi::checkDCM ()
+{
+    init_error.clear();
+    try
+    {
+        if (!broker->getProxy("ALLauncher")->call<bool>("isModulePresent", std::string("DCM")))
+        {
+            init_error = "Error no DCM running";
+        }
+    }
+    catch (ALError& e)
+    {
+        init_error = "Error when connecting to DCM: " + string (e.what());
+    }
+}
+
+
+
+/**
+ * @brief Initialization of ALmemory fast access and aliases.
+ *
+ * @param[in] joint_names names of the joints
+ */
+void robotIONaoqi::connect (const vector<string> &joint_names)
+{
+    // fast access and aliases are independent, the round trips to the
+    // broker are made concurrently.
+    oruw_timer timer ("connect", 0);
+
+    boost::thread read_thread (&robotIONaoqi::initFastReadSafe, this, boost::cref(joint_names));
+    try
+    {
+        initFastWrite(joint_names);
+    }
+    catch (...)
+    {
+        read_thread.join();
+        throw;
+    }
+    qiLogInfo ("module.oru_walk") << "Startup: aliases are created after " << timer.elapsed() * 1000 << " ms";
+
+    read_thread.join();
+    if (!init_error.empty())
+    {
+        ORUW_IO_THROW(init_error);
+    }
+    qiLogInfo ("module.oru_walk") << "Startup: fast access is ready after " << timer.elapsed() * 1000 << " ms";
+}
+
+
+
+/**
+ * @brief Call initFastRead() and save the error in init_error.
+ *
+ * @param[in] joint_names names of the joints
+ */
+void robotIONaoqi::initFastReadSafe (const vector<string>& joint_names)
+{
+    init_error.clear();
+    try
+    {
+        initFastRead(joint_names);
+    }
+    catch (ALError& e)
+    {
+        init_error = "Error when connecting to sensors: " + string (e.what());
+    }
+    catch (...)
+    {
+        init_error = "Error when connecting to sensors.";
+    }
+}
+
+
+
+/**
+ * @brief Initializes variables, that are necessary for fast reading of data from memory.
+ *
+ * All sensors (see sensorIds) are read with a single call of
+ * ALMemoryFastAccess::GetValues().
+ */
+void robotIONaoqi::initFastRead(const vector<string>& joint_names)
+{
+    // Sensors names
+    vector<string> fSensorKeys;
+
+    fSensorKeys.clear();
+    fSensorKeys.resize(SENSORS_NUM);
+
+
+    // connect to sensors
+    for (int i = 0; i < JOINTS_NUM; i++)
+    {
+        fSensorKeys[i] = joint_names[i] + "/Position/Sensor/Value";
+    }
+
+    fSensorKeys[SENSOR_ANGLE_X] = "Device/SubDeviceList/InertialSensor/AngleX/Sensor/Value";
+    fSensorKeys[SENSOR_ANGLE_Y] = "Device/SubDeviceList/InertialSensor/AngleY/Sensor/Value";
+    fSensorKeys[SENSOR_GYR_X]   = "Device/SubDeviceList/InertialSensor/GyrX/Sensor/Value";
+    fSensorKeys[SENSOR_GYR_Y]   = "Device/SubDeviceList/InertialSensor/GyrY/Sensor/Value";
+    fSensorKeys[SENSOR_ACC_X]   = "Device/SubDeviceList/InertialSensor/AccX/Sensor/Value";
+    fSensorKeys[SENSOR_ACC_Y]   = "Device/SubDeviceList/InertialSensor/AccY/Sensor/Value";
+    fSensorKeys[SENSOR_ACC_Z]   = "Device/SubDeviceList/InertialSensor/AccZ/Sensor/Value";
+
+    fSensorKeys[SENSOR_L_FSR_FRONT_LEFT]  = "Device/SubDeviceList/LFoot/FSR/FrontLeft/Sensor/Value";
+    fSensorKeys[SENSOR_L_FSR_FRONT_RIGHT] = "Device/SubDeviceList/LFoot/FSR/FrontRight/Sensor/Value";
+    fSensorKeys[SENSOR_L_FSR_REAR_LEFT]   = "Device/SubDeviceList/LFoot/FSR/RearLeft/Sensor/Value";
+    fSensorKeys[SENSOR_L_FSR_REAR_RIGHT]  = "Device/SubDeviceList/LFoot/FSR/RearRight/Sensor/Value";
+    fSensorKeys[SENSOR_R_FSR_FRONT_LEFT]  = "Device/SubDeviceList/RFoot/FSR/FrontLeft/Sensor/Value";
+    fSensorKeys[SENSOR_R_FSR_FRONT_RIGHT] = "Device/SubDeviceList/RFoot/FSR/FrontRight/Sensor/Value";
+    fSensorKeys[SENSOR_R_FSR_REAR_LEFT]   = "Device/SubDeviceList/RFoot/FSR/RearLeft/Sensor/Value";
+    fSensorKeys[SENSOR_R_FSR_REAR_RIGHT]  = "Device/SubDeviceList/RFoot/FSR/RearRight/Sensor/Value";
+
+    // Create the fast memory access
+    access_sensor_values->ConnectToVariables(broker, fSensorKeys, false);
+
+    // DCM/Time is an integer, which cannot be represented by a float
+    // without loss of precision, it is read through the pointer together
+    // with the other values.
+    last_dcm_time_ms_ptr = (int *) memory_proxy->getDataPtr("DCM/Time");
+}
+
+
+
+/**
+ * @brief Initializes variables, that are necessary for fast sending of parameters to DCM.
+ */
+void robotIONaoqi::initFastWrite(const vector<string>& joint_names)
+{
+    ALValue jointAliases;
+
+    jointAliases.arraySetSize(2);
+    jointAliases[1].arraySetSize(JOINTS_NUM);
+
+
+    // positions of actuators.
+    jointAliases[0] = std::string("jointActuator"); // Alias for all joint actuators
+    // Create alias
+    try
+    {
+        for (int i = 0; i < JOINTS_NUM; i++)
+        {
+            jointAliases[1][i] = joint_names[i] + "/Position/Actuator/Value";
+        }
+        dcm_proxy->createAlias(jointAliases);
+    }
+    catch (const ALError &e)
+    {
+        ORUW_IO_THROW_ERROR("Error when creating Alias: ", e);
+    }
+
+
+    //  stiffness of actuators.
+    jointAliases[0] = std::string("jointStiffness"); // Alias for all actuators
+    // Create alias
+    try
+    {
+        for (int i = 0; i < JOINTS_NUM; i++)
+        {
+            jointAliases[1][i] = joint_names[i] + "/Hardness/Actuator/Value";
+        }
+        dcm_proxy->createAlias(jointAliases);
+    }
+    catch (const ALError &e)
+    {
+        ORUW_IO_THROW_ERROR("Error when creating Alias: ", e);
+    }
+
+
+
+    // access to the actuators in the lower body only
+    jointAliases[1].clear();
+    jointAliases[1].arraySetSize(LOWER_JOINTS_NUM);
+
+    // positions of actuators.
+    jointAliases[0] = std::string("lowerJointActuator"); // Alias for all joint actuators
+    // Create alias
+    try
+    {
+        for (int i = 0; i < LOWER_JOINTS_NUM; i++)
+        {
+            jointAliases[1][i] = joint_names[i] + "/Position/Actuator/Value";
+        }
+        dcm_proxy->createAlias(jointAliases);
+    }
+    catch (const ALError &e)
+    {
+        ORUW_IO_THROW_ERROR("Error when creating Alias: ", e);
+    }
+}
+
+
+
+void robotIONaoqi::readSensors (vector<float> &values, int &dcm_time_ms)
+{
+    dcm_time_ms = *last_dcm_time_ms_ptr;
+    access_sensor_values->GetValues (values);
+}
+
+
+
+int robotIONaoqi::getCycleTime ()
+{
+    return (*last_dcm_time_ms_ptr);
+}
+
+
+
+int robotIONaoqi::getTime (const int shift_ms)
+{
+    return (dcm_proxy->getTime(shift_ms));
+}
+
+
+
+void robotIONaoqi::setAlias (const ALValue &commands)
+{
+    dcm_proxy->setAlias(commands);
+}
+
+
+
+int robotIONaoqi::setStiffness (const float stiffness, const int change_time_ms)
+{
+    ALValue stiffnessCommands;
+    int end_time_ms;
+
+
+    // Prepare one dcm command:
+    // it will linearly "Merge" all joint stiffness
+    // from last value to "stiffnessValue" in change_time_ms
+    stiffnessCommands.arraySetSize(3);
+    stiffnessCommands[0] = std::string("jointStiffness");
+    stiffnessCommands[1] = std::string("Merge");
+    stiffnessCommands[2].arraySetSize(1);
+    stiffnessCommands[2][0].arraySetSize(2);
+    stiffnessCommands[2][0][0] = stiffness;
+
+
+    try
+    {
+        end_time_ms = dcm_proxy->getTime(change_time_ms);
+        stiffnessCommands[2][0][1] = end_time_ms;
+    }
+    catch (const ALError &e)
+    {
+        ORUW_IO_THROW_ERROR("Error on DCM getTime : ", e);
+    }
+
+
+    try
+    {
+        dcm_proxy->set(stiffnessCommands);
+    }
+    catch (const ALError &e)
+    {
+        ORUW_IO_THROW_ERROR("Error when sending stiffness to DCM : ", e);
+    }
+
+    return (end_time_ms);
+}
+
+
+
+void robotIONaoqi::connectCallback (const boost::function<void ()> &callback)
+{
+    dcm_callback_connection = broker->getProxy("DCM")->getModule()->atPostProcess (callback);
+}
+
+
+
+void robotIONaoqi::disconnectCallback ()
+{
+    dcm_callback_connection.disconnect();
+}
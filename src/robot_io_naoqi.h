@@ -0,0 +1,66 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef ROBOT_IO_NAOQI_H
+#define ROBOT_IO_NAOQI_H
+
+
+#include <alcore/alptr.h>
+#include <alcore/alerror.h>
+
+#include <alcommon/alproxy.h>
+#include <alcommon/albroker.h>
+
+#include <alproxies/dcmproxy.h>
+#include <alproxies/almemoryproxy.h>
+
+#include <almemoryfastaccess/almemoryfastaccess.h>
+
+#include <boost/thread.hpp>
+
+#include "robot_io.h"
+
+
+/**
+ * @brief The interface to the robot through the DCM of NAOqi.
+ */
+class robotIONaoqi : public robotIO
+{
+    public:
+        robotIONaoqi (ALPtr<ALBroker>);
+
+        void connect (const vector<string> &);
+        void readSensors (vector<float> &, int &);
+        int getCycleTime ();
+        int getTime (const int);
+        void setAlias (const ALValue &);
+        int setStiffness (const float, const int);
+        void connectCallback (const boost::function<void ()> &);
+        void disconnectCallback ();
+
+
+    private:
+        void checkDCM ();
+        void initFastRead (const vector<string>&);
+        void initFastReadSafe (const vector<string>&);
+        void initFastWrite (const vector<string>&);
+
+
+        ALPtr<ALBroker> broker;
+        ALPtr<DCMProxy> dcm_proxy;
+        ALPtr<ALMemoryProxy> memory_proxy;
+
+        // Used for fast memory access
+        ALPtr<ALMemoryFastAccess> access_sensor_values;
+        int* last_dcm_time_ms_ptr;
+
+        ProcessSignalConnection dcm_callback_connection;
+
+        // an error in a concurrent step of initialization
+        string init_error;
+};
+
+#endif // ROBOT_IO_NAOQI_H
@@ -0,0 +1,244 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+#include <algorithm> // min
+
+#include "robot_io_sim.h"
+#include "oruw_scheduler.h"
+#include "sensor_snapshot.h"
+
+
+
+/**
+ * @brief Start the simulated DCM.
+ *
+ * @param[in] dcm_sampling_time_ms the period of the DCM
+ * @param[in] delay_ms delay between the actuators and the sensors, it is
+ * rounded to a multiple of the period.
+ */
+robotIOSim::robotIOSim (const int dcm_sampling_time_ms, const int delay_ms)
+{
+    sampling_time_ms = dcm_sampling_time_ms;
+    dcm_time_ms = 0;
+    stiffness = 0.0;
+
+    for (int i = 0; i < JOINTS_NUM; i++)
+    {
+        commands_num[i] = 0;
+        last_commands[i].time_ms = 0;
+        last_commands[i].value = 0.0;
+        actuators[i] = 0.0;
+    }
+
+    history.resize(delay_ms / sampling_time_ms + 1, vector<float>(JOINTS_NUM, 0.0));
+    history_index = 0;
+
+    stop = false;
+    thread = new boost::thread(&robotIOSim::loop, this);
+}
+
+
+
+robotIOSim::~robotIOSim ()
+{
+    stop = true;
+    thread->join();
+    delete thread;
+}
+
+
+
+/**
+ * @brief Nothing to connect to: the joints are identified by their
+ * numbers.
+ */
+void robotIOSim::connect (const vector<string> &)
+{
+}
+
+
+
+/**
+ * @brief The joints are reported with delay, the robot is assumed to be
+ * upright and its feet are not loaded: the inertial unit and the FSR are
+ * not simulated.
+ */
+void robotIOSim::readSensors (vector<float> &values, int &dcm_time_ms)
+{
+    boost::mutex::scoped_lock lock(data_mutex);
+
+    dcm_time_ms = this->dcm_time_ms;
+
+    // the oldest values in the history
+    const vector<float> &sensors = history[(history_index + 1) % history.size()];
+    for (int i = 0; i < JOINTS_NUM; i++)
+    {
+        values[i] = sensors[i];
+    }
+    for (int i = JOINTS_NUM; i < SENSORS_NUM; i++)
+    {
+        values[i] = 0.0;
+    }
+    values[SENSOR_ACC_Z] = -9.81;
+}
+
+
+
+int robotIOSim::getCycleTime ()
+{
+    return (dcm_time_ms);
+}
+
+
+
+int robotIOSim::getTime (const int shift_ms)
+{
+    return (dcm_time_ms + shift_ms);
+}
+
+
+
+/**
+ * @brief Queue the commands, only "ClearAll" and "time-separate" commands
+ * for "jointActuator" and "lowerJointActuator" aliases are supported.
+ *
+ * @param[in] commands commands in the format of DCM::setAlias().
+ */
+void robotIOSim::setAlias (const ALValue &commands)
+{
+    int joints_num;
+    // not copied: no memory is allocated in the control loop
+    const string &alias = commands[0];
+    if (alias == "jointActuator")
+    {
+        joints_num = JOINTS_NUM;
+    }
+    else if (alias == "lowerJointActuator")
+    {
+        joints_num = LOWER_JOINTS_NUM;
+    }
+    else
+    {
+        return;
+    }
+
+
+    boost::mutex::scoped_lock lock(data_mutex);
+
+    int samples_num = min (commands[4].getSize(), ORUW_SIM_MAX_COMMANDS);
+    for (int i = 0; i < joints_num; i++)
+    {
+        // ClearAll: the motion starts from the current position
+        last_commands[i].time_ms = dcm_time_ms;
+        last_commands[i].value = actuators[i];
+
+        commands_num[i] = samples_num;
+        for (int j = 0; j < samples_num; j++)
+        {
+            this->commands[i][j].time_ms = commands[4][j];
+            this->commands[i][j].value = commands[5][i][j];
+        }
+    }
+}
+
+
+
+/**
+ * @brief Stiffness is not simulated.
+ */
+int robotIOSim::setStiffness (const float new_stiffness, const int change_time_ms)
+{
+    stiffness = new_stiffness;
+    return (getTime(change_time_ms));
+}
+
+
+
+void robotIOSim::connectCallback (const boost::function<void ()> &new_callback)
+{
+    boost::mutex::scoped_lock lock(callback_mutex);
+    callback = new_callback;
+}
+
+
+
+void robotIOSim::disconnectCallback ()
+{
+    boost::mutex::scoped_lock lock(callback_mutex);
+    callback.clear();
+}
+
+
+
+/**
+ * @brief Move the actuators towards the queued commands.
+ */
+void robotIOSim::updateActuators ()
+{
+    for (int i = 0; i < JOINTS_NUM; i++)
+    {
+        // drop the reached commands
+        int reached = 0;
+        while ((reached < commands_num[i]) && (commands[i][reached].time_ms <= dcm_time_ms))
+        {
+            last_commands[i] = commands[i][reached];
+            ++reached;
+        }
+        for (int j = reached; j < commands_num[i]; j++)
+        {
+            commands[i][j - reached] = commands[i][j];
+        }
+        commands_num[i] -= reached;
+
+
+        if (commands_num[i] == 0)
+        {
+            actuators[i] = last_commands[i].value;
+        }
+        else
+        {
+            const timedCommand &next = commands[i][0];
+            actuators[i] = last_commands[i].value
+                + (next.value - last_commands[i].value)
+                * (dcm_time_ms - last_commands[i].time_ms)
+                / (next.time_ms - last_commands[i].time_ms);
+        }
+    }
+
+    history_index = (history_index + 1) % history.size();
+    for (int i = 0; i < JOINTS_NUM; i++)
+    {
+        history[history_index][i] = actuators[i];
+    }
+}
+
+
+
+/**
+ * @brief The cycles of the simulated DCM.
+ */
+void robotIOSim::loop ()
+{
+    oruw_scheduler scheduler;
+    scheduler.start (sampling_time_ms, 0, dcm_time_ms);
+
+    while (!stop)
+    {
+        // the time of the DCM is not stopped, if a cycle is missed
+        int missed_cycles = scheduler.wait(dcm_time_ms);
+
+        {
+            boost::mutex::scoped_lock lock(data_mutex);
+            dcm_time_ms += (missed_cycles + 1) * sampling_time_ms;
+            updateActuators();
+        }
+
+        boost::mutex::scoped_lock lock(callback_mutex);
+        if (callback)
+        {
+            callback();
+        }
+    }
+}
@@ -0,0 +1,84 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef ROBOT_IO_SIM_H
+#define ROBOT_IO_SIM_H
+
+
+#include <boost/thread.hpp>
+
+#include "robot_io.h"
+#include "joints_sensors_id.h"
+
+
+/// the maximal number of timed commands queued for one joint
+#define ORUW_SIM_MAX_COMMANDS 64
+
+
+/**
+ * @brief A simulated DCM: the commanded joint angles are interpolated
+ * linearly between timed commands and are reported by the sensors with
+ * a fixed delay. The callback is called after each cycle of the DCM.
+ */
+class robotIOSim : public robotIO
+{
+    public:
+        robotIOSim (const int, const int);
+        ~robotIOSim ();
+
+        void connect (const vector<string> &);
+        void readSensors (vector<float> &, int &);
+        int getCycleTime ();
+        int getTime (const int);
+        void setAlias (const ALValue &);
+        int setStiffness (const float, const int);
+        void connectCallback (const boost::function<void ()> &);
+        void disconnectCallback ();
+
+
+    private:
+        /**
+         * @brief A target angle of a joint.
+         */
+        class timedCommand
+        {
+            public:
+                int time_ms;
+                float value;
+        };
+
+
+        void loop ();
+        void updateActuators ();
+
+
+        boost::thread *thread;
+        volatile bool stop;
+
+        boost::mutex data_mutex;
+        boost::mutex callback_mutex;
+        boost::function<void ()> callback;
+
+        int sampling_time_ms;
+        volatile int dcm_time_ms;
+
+        // queued commands
+        timedCommand commands[JOINTS_NUM][ORUW_SIM_MAX_COMMANDS];
+        int commands_num[JOINTS_NUM];
+        // the last reached command
+        timedCommand last_commands[JOINTS_NUM];
+
+        // current values of the actuators
+        float actuators[JOINTS_NUM];
+        // the values of the actuators in the last cycles, the oldest
+        // values are reported by the sensors
+        vector< vector<float> > history;
+        int history_index;
+
+        float stiffness;
+};
+
+#endif // ROBOT_IO_SIM_H
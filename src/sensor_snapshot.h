@@ -0,0 +1,84 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef SENSOR_SNAPSHOT_H
+#define SENSOR_SNAPSHOT_H
+
+
+#include "joints_sensors_id.h"
+#include "nao_igm.h"
+
+
+/**
+ * @brief Indices of the sensors in the bundle, which is read at once; the
+ * joint angles come first.
+ */
+enum sensorIds
+{
+    // inertial unit
+    SENSOR_ANGLE_X = JOINTS_NUM,
+    SENSOR_ANGLE_Y,
+    SENSOR_GYR_X,
+    SENSOR_GYR_Y,
+    SENSOR_ACC_X,
+    SENSOR_ACC_Y,
+    SENSOR_ACC_Z,
+
+    // force sensitive resistors
+    SENSOR_L_FSR_FRONT_LEFT,
+    SENSOR_L_FSR_FRONT_RIGHT,
+    SENSOR_L_FSR_REAR_LEFT,
+    SENSOR_L_FSR_REAR_RIGHT,
+    SENSOR_R_FSR_FRONT_LEFT,
+    SENSOR_R_FSR_FRONT_RIGHT,
+    SENSOR_R_FSR_REAR_LEFT,
+    SENSOR_R_FSR_REAR_RIGHT,
+
+    SENSORS_NUM
+};
+
+
+/**
+ * @brief Sensor data, which is read in the DCM callback and passed to the
+ * walk control thread.
+ */
+class sensorSnapshot
+{
+    public:
+        /**
+         * @brief Copy the joint angles to the state of the model.
+         *
+         * @param[out] joint_state state of the model
+         */
+        void getJointState (jointState &joint_state) const
+        {
+            for (int i = 0; i < JOINTS_NUM; i++)
+            {
+                joint_state.q[i] = values[i];
+            }
+        }
+
+
+        /**
+         * @param[in] left the left foot if true, the right foot otherwise.
+         *
+         * @return the sum of the values of the FSR of a foot.
+         */
+        float getFootWeight (const bool left) const
+        {
+            int first = left ? SENSOR_L_FSR_FRONT_LEFT : SENSOR_R_FSR_FRONT_LEFT;
+            return (values[first] + values[first + 1] + values[first + 2] + values[first + 3]);
+        }
+
+
+        /// values of the sensors as they are returned by ALMemoryFastAccess
+        float values[SENSORS_NUM];
+
+        /// the DCM time, when the data was read
+        int dcm_time_ms;
+};
+
+#endif // SENSOR_SNAPSHOT_H
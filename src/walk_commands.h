@@ -0,0 +1,112 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ */
+
+
+#ifndef WALK_COMMANDS_H
+#define WALK_COMMANDS_H
+
+
+#include <string>
+#include <vector>
+
+#include <alvalue/alvalue.h> // ALValue
+
+#include "joints_sensors_id.h"
+#include "nao_igm.h"
+
+
+using namespace AL;
+using namespace std;
+
+
+/**
+ * @brief Timed commands for the lower body joints in the format of
+ * DCM::setAlias().
+ *
+ * The structure of the commands is created once, the addresses of the
+ * values inside the ALValue are cached, so that the commands are updated
+ * without indexing of the nested ALValue arrays and without allocation
+ * of memory.
+ */
+class walkCommands
+{
+    public:
+        /**
+         * @brief Create the structure of the commands.
+         *
+         * @param[in] alias name of the alias
+         * @param[in] samples_num number of timed samples in the commands
+         */
+        void init (const string &alias, const int samples_num)
+        {
+            commands.arraySetSize(6);
+            commands[0] = alias;
+            commands[1] = string("ClearAll");
+            commands[2] = string("time-separate");
+            commands[3] = 0;
+
+            // The types of the values are set here and are not changed later,
+            // otherwise memory may be allocated, when the commands are updated.
+            commands[4].arraySetSize(samples_num);
+            for (int j = 0; j < samples_num; j++)
+            {
+                commands[4][j] = 0;
+            }
+
+            commands[5].arraySetSize(LOWER_JOINTS_NUM); // For all joints
+            for (int i=0; i < LOWER_JOINTS_NUM; i++)
+            {
+                commands[5][i].arraySetSize(samples_num);
+                for (int j = 0; j < samples_num; j++)
+                {
+                    commands[5][i][j] = 0.0f;
+                }
+            }
+
+
+            // The arrays are not resized later, hence the addresses do
+            // not change.
+            time_slots.resize(samples_num);
+            value_slots.resize(samples_num * LOWER_JOINTS_NUM);
+            for (int j = 0; j < samples_num; j++)
+            {
+                time_slots[j] = &static_cast<int &>(commands[4][j]);
+                for (int i = 0; i < LOWER_JOINTS_NUM; i++)
+                {
+                    value_slots[j * LOWER_JOINTS_NUM + i] = &static_cast<float &>(commands[5][i][j]);
+                }
+            }
+        }
+
+
+        /**
+         * @brief Set one timed sample.
+         *
+         * @param[in] sample index of the sample
+         * @param[in] dcm_time_ms the DCM time, when the angles must be reached
+         * @param[in] joint_state target joint angles
+         */
+        void set (const int sample, const int dcm_time_ms, const jointState &joint_state)
+        {
+            *time_slots[sample] = dcm_time_ms;
+
+            float **slots = &value_slots[sample * LOWER_JOINTS_NUM];
+            for (int i = 0; i < LOWER_JOINTS_NUM; i++)
+            {
+                *slots[i] = (float) joint_state.q[i];
+            }
+        }
+
+
+        /// the commands, which are sent to the DCM
+        ALValue commands;
+
+
+    private:
+        vector<int *> time_slots;
+        vector<float *> value_slots;
+};
+
+#endif // WALK_COMMANDS_H
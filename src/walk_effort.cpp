@@ -0,0 +1,100 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief Closed-loop control of the effort of the solvers: the limits on
+ * the number of iterations of the MPC and IK solvers are adapted to the
+ * measured execution time of the control loop.
+ */
+
+#include <algorithm> // max, min
+
+#include "oru_walk.h"
+#include "oruw_log.h"
+
+
+/**
+ * Effort is increased, when the 99th percentile of the loop time is below
+ * this fraction of the target.
+ */
+#define ORUW_EFFORT_HYSTERESIS 0.8
+
+
+
+/**
+ * @brief Reset the effort controller, the solvers start with the limits
+ * given in the parameters.
+ */
+void oru_walk::initEffortControl()
+{
+    loop_time_window.reset();
+    effort_level = 0;
+    igm_max_iter = wp.igm_max_iter;
+}
+
+
+
+/**
+ * @brief Adapt the effort of the solvers to the execution time of the
+ * control loop. Once the window of measurements is full, the effort is
+ * decreased if the 99th percentile exceeds the target, and increased if
+ * there is enough headroom. IK iterations are reduced first (down to half
+ * of igm_max_iter), then a solver with a lower limit on the number of
+ * iterations is selected; the effort is increased in the reverse order.
+ *
+ * @param[in] loop_time execution time of the last control loop (in seconds).
+ */
+void oru_walk::adaptEffort(const double loop_time)
+{
+    loop_time_window.add(loop_time);
+    if (!loop_time_window.isFull())
+    {
+        return;
+    }
+
+
+    double target = wp.effort_target_ratio * wp.loop_time_limit_ms / 1000;
+    double p99 = loop_time_window.getPercentile(0.99);
+    int igm_step = max (1, wp.igm_max_iter / 8);
+    bool changed = false;
+
+    if (p99 > target)
+    {
+        if (igm_max_iter > wp.igm_max_iter / 2)
+        {
+            igm_max_iter = max (wp.igm_max_iter / 2, igm_max_iter - igm_step);
+            changed = true;
+        }
+        else if ((effort_level < ORUW_SOLVER_LADDER_SIZE - 1) && (solver_ladder[effort_level + 1] != NULL))
+        {
+            ++effort_level;
+            changed = true;
+        }
+    }
+    else if (p99 < ORUW_EFFORT_HYSTERESIS * target)
+    {
+        if (effort_level > 0)
+        {
+            --effort_level;
+            changed = true;
+        }
+        else if (igm_max_iter < wp.igm_max_iter)
+        {
+            igm_max_iter = min (wp.igm_max_iter, igm_max_iter + igm_step);
+            changed = true;
+        }
+    }
+
+
+    if (changed)
+    {
+        ORUW_LOG_MESSAGE("Effort: p50 = %f // p99 = %f // target = %f // solver level = %d // IK iterations = %d\n",
+                loop_time_window.getPercentile(0.5),
+                p99,
+                target,
+                effort_level,
+                igm_max_iter);
+        // the new limits must be evaluated on new measurements
+        loop_time_window.reset();
+    }
+}
@@ -0,0 +1,152 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief Explicit MPC: the solutions of the MPC problems are taken from a
+ * precomputed table of affine control laws, the online solver is used
+ * when the problem is not in the table, the initial state or the
+ * corrected positions of the steps are outside of the box, where the law
+ * is valid, or the evaluated solution violates the bounds on the ZMP.
+ */
+
+#include <cmath> // fabs
+
+#include "oru_walk.h"
+#include "oruw_log.h"
+
+
+/// the table is loaded from this file
+#define ORUW_EMPC_TABLE_FILE "./oru_empc.table"
+/// the maximal difference between the height of the CoM used for the table
+/// and the current height of the CoM
+#define ORUW_EMPC_HCOM_TOLERANCE 0.002
+
+
+
+/**
+ * @brief Load the table and check, that it is built for the current
+ * parameters. The lookup is disabled otherwise.
+ *
+ * @param[in] hCoM height of the CoM
+ */
+void oru_walk::initMPCLookup (const double hCoM)
+{
+    empc_enabled = false;
+    empc_used = false;
+    empc_hits_num = 0;
+    empc_misses_num = 0;
+    empc_rejected_num = 0;
+
+    if (!wp.mpc_lookup)
+    {
+        return;
+    }
+
+    const char *error = NULL;
+    if (wp.command_horizon > ORUW_EMPC_STATES_NUM)
+    {
+        error = "the command horizon is longer than the stored solution.";
+    }
+    else if (!empc_table.load (ORUW_EMPC_TABLE_FILE))
+    {
+        error = "cannot load " ORUW_EMPC_TABLE_FILE;
+    }
+    else if ((empc_table.header.preview_window_size != wp.preview_window_size)
+            || (empc_table.header.gain_position != (float) wp.mpc_gain_position)
+            || (empc_table.header.gain_velocity != (float) wp.mpc_gain_velocity)
+            || (empc_table.header.gain_acceleration != (float) wp.mpc_gain_acceleration)
+            || (empc_table.header.gain_jerk != (float) wp.mpc_gain_jerk))
+    {
+        error = "the table is built for different parameters of the MPC.";
+    }
+    else if (fabs (empc_table.header.hCoM - hCoM) > ORUW_EMPC_HCOM_TOLERANCE)
+    {
+        error = "the table is built for a different height of the CoM.";
+    }
+
+    if (error != NULL)
+    {
+        ORUW_LOG_MESSAGE("MPC lookup is disabled: %s (hCoM = %f)\n", error, hCoM);
+        qiLogInfo ("module.oru_walk") << "MPC lookup is disabled: " << error;
+        return;
+    }
+
+    empc_enabled = true;
+    ORUW_LOG_MESSAGE("MPC lookup: %d laws are loaded.\n", empc_table.header.laws_num);
+}
+
+
+
+/**
+ * @brief Try to obtain the solution of the MPC problem from the table.
+ *
+ * @param[in,out] mpc MPC parameters, the initial state is updated on
+ * success.
+ *
+ * @return true if the solution is found.
+ */
+bool oru_walk::lookupMPCSolution (smpc_parameters &mpc)
+{
+    empc_used = false;
+    if (!empc_enabled)
+    {
+        return (false);
+    }
+
+    if (empc_problem.set (mpc, wp.preview_window_size))
+    {
+        const oruw_empc_law *law = empc_table.find (empc_problem);
+        if ((law != NULL)
+                && oruw_empc_table::evaluate (*law, empc_problem, mpc.init_state, empc_states))
+        {
+            if (oruw_empc_table::checkBounds (mpc, empc_states))
+            {
+                empc_used = true;
+                ++empc_hits_num;
+                mpc.init_state = empc_states[0];
+                return (true);
+            }
+            ++empc_rejected_num;
+        }
+    }
+
+    ++empc_misses_num;
+    return (false);
+}
+
+
+
+/**
+ * @brief Get a state from the solution of the last MPC problem.
+ *
+ * @param[out] state the state
+ * @param[in] index index of the state in the preview window
+ */
+void oru_walk::getMPCState (smpc::state_com &state, const int index)
+{
+    if (empc_used)
+    {
+        state = empc_states[index];
+    }
+    else
+    {
+        solver->get_state(state, index);
+    }
+}
+
+
+
+/**
+ * @brief Log the number of problems solved by the lookup.
+ */
+void oru_walk::logMPCLookup()
+{
+    if (empc_enabled)
+    {
+        ORUW_LOG_MESSAGE("MPC lookup: hits = %d // misses = %d (bounds violated = %d)\n",
+                empc_hits_num, empc_misses_num, empc_rejected_num);
+        qiLogInfo ("module.oru_walk") << "MPC lookup: hits = " << empc_hits_num
+            << " / misses = " << empc_misses_num
+            << " (bounds violated = " << empc_rejected_num << ")";
+    }
+}
@@ -0,0 +1,149 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief Adaptation of the length of the preview window to the execution
+ * time of the control loop. The preview window is always formed with
+ * preview_window_size samples, a shorter solver uses its beginning, hence
+ * nothing has to be transferred, when the length is switched: the
+ * initial state is shared and WMG is not changed.
+ */
+
+#include <algorithm> // max, min
+
+#include "oru_walk.h"
+#include "oruw_log.h"
+
+
+/**
+ * The preview window is shortened, when the last control loop took more
+ * than this fraction of loop_time_limit_ms.
+ */
+#define ORUW_HORIZON_HIGH_RATIO 0.8
+/**
+ * The preview window is lengthened after ORUW_HORIZON_HOLD_LOOPS control
+ * loops, which took less than this fraction of loop_time_limit_ms.
+ */
+#define ORUW_HORIZON_LOW_RATIO 0.5
+#define ORUW_HORIZON_HOLD_LOOPS 10
+
+
+
+/**
+ * @brief Create solvers for the shorter preview windows. The lengths are
+ * evenly distributed between preview_window_size and
+ * preview_window_min_size, the limits on the number of iterations are
+ * taken from the parameters.
+ */
+void oru_walk::initHorizon()
+{
+    horizon_level = 0;
+    horizon_slack_loops = 0;
+    for (int i = 0; i < ORUW_HORIZON_LEVELS; i++)
+    {
+        solver_horizon[i] = NULL;
+        horizon_size[i] = wp.preview_window_size;
+        horizon_loops_num[i] = 0;
+    }
+
+    if (!wp.preview_window_adaptive)
+    {
+        return;
+    }
+
+    // the first two states of the solution are always used
+    int min_size = max (max (2, wp.command_horizon), wp.preview_window_min_size);
+    min_size = min (min_size, wp.preview_window_size);
+    for (int i = 1; i < ORUW_HORIZON_LEVELS; i++)
+    {
+        horizon_size[i] = wp.preview_window_size
+            - i * (wp.preview_window_size - min_size) / (ORUW_HORIZON_LEVELS - 1);
+        solver_horizon[i] = getSolver (wp.mpc_solver_type, horizon_size[i], 0);
+    }
+}
+
+
+
+/**
+ * @brief Select the solver for the current length of the preview window.
+ * The full preview window is handled by the solver ladder.
+ */
+void oru_walk::selectHorizon()
+{
+    ++horizon_loops_num[horizon_level];
+    if (horizon_level > 0)
+    {
+        solver = solver_horizon[horizon_level];
+    }
+}
+
+
+
+/**
+ * @brief Adapt the length of the preview window to the execution time of
+ * the last control loop: it is shortened immediately, when the loop is
+ * close to the limit, and lengthened after a sequence of fast loops.
+ *
+ * @param[in] loop_time execution time of the last control loop (in seconds).
+ */
+void oru_walk::adaptHorizon(const double loop_time)
+{
+    if (!wp.preview_window_adaptive)
+    {
+        return;
+    }
+
+    const double limit = (double) wp.loop_time_limit_ms / 1000;
+    int level = horizon_level;
+
+    if (loop_time > ORUW_HORIZON_HIGH_RATIO * limit)
+    {
+        horizon_slack_loops = 0;
+        if (level < ORUW_HORIZON_LEVELS - 1)
+        {
+            ++level;
+        }
+    }
+    else if (loop_time < ORUW_HORIZON_LOW_RATIO * limit)
+    {
+        ++horizon_slack_loops;
+        if ((horizon_slack_loops >= ORUW_HORIZON_HOLD_LOOPS) && (level > 0))
+        {
+            horizon_slack_loops = 0;
+            --level;
+        }
+    }
+    else
+    {
+        horizon_slack_loops = 0;
+    }
+
+
+    if (level != horizon_level)
+    {
+        horizon_level = level;
+        ORUW_LOG_MESSAGE("Horizon: loop time = %f // limit = %f // preview window = %d\n",
+                loop_time, limit, horizon_size[horizon_level]);
+    }
+}
+
+
+
+/**
+ * @brief Log the number of control loops with each length of the preview
+ * window.
+ */
+void oru_walk::logHorizon()
+{
+    if (!wp.preview_window_adaptive)
+    {
+        return;
+    }
+
+    for (int i = 0; i < ORUW_HORIZON_LEVELS; i++)
+    {
+        ORUW_LOG_MESSAGE("Horizon: preview window = %d // loops = %d\n", horizon_size[i], horizon_loops_num[i]);
+        qiLogInfo ("module.oru_walk") << "Horizon: preview window = " << horizon_size[i]
+            << ", loops = " << horizon_loops_num[i];
+    }
+}
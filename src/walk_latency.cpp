@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief Online estimation of the latency between the commands and the
+ * sensor readings, the estimate is used to shift the time of the commands
+ * instead of the constant dcm_time_shift_ms.
+ */
+
+#include <algorithm> // max, min
+#include <cmath> // floor
+
+#include "oru_walk.h"
+#include "oruw_log.h"
+
+
+/// gain of the low-pass filter applied to the estimate of the latency
+#define ORUW_LATENCY_FILTER_GAIN 0.1
+
+
+
+/**
+ * @brief Reset the estimator, the commands are not shifted until a
+ * confident estimate is obtained. If the estimation is disabled, the
+ * commands are shifted by the constant dcm_time_shift_ms.
+ */
+void oru_walk::initLatencyEstimation()
+{
+    latency_estimator.init (wp.dcm_sampling_time_ms, wp.latency_max_ms);
+    latency_filtered_ms = 0.0;
+    command_time_shift_ms = wp.latency_estimation ? 0 : wp.dcm_time_shift_ms;
+    latency_estimate_ms = 0.0;
+    latency_confidence = 0.0;
+}
+
+
+
+/**
+ * @brief Shift the time of a command.
+ *
+ * The shift is applied to each command separately: a command, which would
+ * be moved before the given time, is due at this time instead. Hence the
+ * first commands of a message (which are due soon) are shifted less than
+ * the estimated latency, while the later commands are shifted by the full
+ * estimate. Clamping of the shift itself would limit it to the distance
+ * between the sensor data and the first command, i.e. one DCM period with
+ * the default parameters. The constant dcm_time_shift_ms is applied
+ * without clamping, as before the estimation was introduced.
+ *
+ * @param[in] dcm_time_ms the DCM time, when the angles must be reached
+ * @param[in] earliest_time_ms the earliest allowed time, normally the next
+ * DCM cycle after the sensor data or the previous command of the message
+ * plus one DCM period.
+ *
+ * @return the DCM time of the command.
+ */
+int oru_walk::shiftCommandTime (const int dcm_time_ms, const int earliest_time_ms)
+{
+    if (!wp.latency_estimation)
+    {
+        return (dcm_time_ms + command_time_shift_ms);
+    }
+    return (max (dcm_time_ms + command_time_shift_ms, earliest_time_ms));
+}
+
+
+
+/**
+ * @brief Pass a command to the estimator and update the shift of the time
+ * of the commands.
+ *
+ * @param[in] dcm_time_ms the DCM time, when the angles must be reached
+ * (as sent to the DCM)
+ * @param[in] joint_state the commanded angles
+ */
+void oru_walk::estimateLatency (const int dcm_time_ms, const jointState &joint_state)
+{
+    if (!wp.latency_estimation)
+    {
+        return;
+    }
+
+    latency_estimator.addCommand (dcm_time_ms, joint_state);
+    if (!latency_estimator.update (sensor_history))
+    {
+        return;
+    }
+
+    latency_estimate_ms = latency_estimator.latency_ms;
+    latency_confidence = latency_estimator.confidence;
+
+    if (latency_estimator.confidence >= wp.latency_min_confidence)
+    {
+        latency_filtered_ms += ORUW_LATENCY_FILTER_GAIN * (latency_estimator.latency_ms - latency_filtered_ms);
+
+        // the commands are sent ahead by the latency
+        double shift_ms = min ((double) wp.latency_max_ms, max (0.0, latency_filtered_ms));
+        command_time_shift_ms = - (int) floor (shift_ms + 0.5);
+    }
+}
+
+
+
+/**
+ * @return the last estimate of the latency (ms).
+ */
+float oru_walk::getLatencyEstimate()
+{
+    return (latency_estimate_ms);
+}
+
+
+
+/**
+ * @return the confidence of the last estimate of the latency [0;1].
+ */
+float oru_walk::getLatencyConfidence()
+{
+    return (latency_confidence);
+}
@@ -0,0 +1,151 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief The multi-rate control loop: the MPC problem is solved once per
+ * preview sampling period, IK is solved once per control loop for the CoM
+ * positions interpolated from the last solution, the joint angles are
+ * interpolated to the sampling rate of the DCM.
+ */
+
+#include "oru_walk.h"
+#include "oruw_log.h"
+
+
+/**
+ * @brief Interpolate the state of the CoM between two states using cubic
+ * Hermite polynomials for positions, accelerations are interpolated
+ * linearly.
+ *
+ * @param[in] state_0 the first state
+ * @param[in] state_1 the second state
+ * @param[in] T time between the states (in seconds)
+ * @param[in] s relative time in the range [0, 1]
+ * @param[out] CoM the interpolated state
+ *
+ * @note The elements of the state vector are x, dx, ddx, y, dy, ddy.
+ */
+static void interpolateCoM (
+        const smpc::state_com &state_0,
+        const smpc::state_com &state_1,
+        const double T,
+        const double s,
+        smpc::state_com &CoM)
+{
+    double s2 = s*s;
+    double s3 = s2*s;
+
+    // basis functions and their derivatives
+    double h00 = 2*s3 - 3*s2 + 1;
+    double h10 = s3 - 2*s2 + s;
+    double h01 = -2*s3 + 3*s2;
+    double h11 = s3 - s2;
+
+    double dh00 = (6*s2 - 6*s) / T;
+    double dh10 = 3*s2 - 4*s + 1;
+    double dh01 = (-6*s2 + 6*s) / T;
+    double dh11 = 3*s2 - 2*s;
+
+    for (int i = 0; i < 6; i += 3)
+    {
+        double p0 = state_0.state_vector[i];
+        double v0 = state_0.state_vector[i+1];
+        double p1 = state_1.state_vector[i];
+        double v1 = state_1.state_vector[i+1];
+
+        CoM.state_vector[i]   = h00*p0 + h10*T*v0 + h01*p1 + h11*T*v1;
+        CoM.state_vector[i+1] = dh00*p0 + dh10*v0 + dh01*p1 + dh11*v1;
+        CoM.state_vector[i+2] = (1 - s) * state_0.state_vector[i+2] + s * state_1.state_vector[i+2];
+    }
+}
+
+
+
+/**
+ * @brief Initialize the multi-rate control loop.
+ *
+ * @param[in] joint_state the current target joint angles
+ */
+void oru_walk::initMultiRate (const jointState &joint_state)
+{
+    multirate_loop_index = 0;
+    multirate_last_target = joint_state;
+}
+
+
+
+/**
+ * @brief Remember the solution of the MPC problem, must be called after
+ * the problem is solved.
+ *
+ * @param[in] init_state the state, which was used in the MPC problem
+ * as the initial state.
+ */
+void oru_walk::setMultiRateCoM (const smpc::state_com &init_state)
+{
+    multirate_CoM[0] = init_state;
+    getMPCState (multirate_CoM[1], 0);
+}
+
+
+
+/**
+ * @brief Solve the IK problem for the next control loop and send the joint
+ * angles interpolated to the sampling rate of the DCM.
+ *
+ * @param[in] mpc MPC parameters
+ * @param[in,out] wmg WMG
+ */
+void oru_walk::solveIKsendCommandsMultiRate (
+        const smpc_parameters &mpc,
+        WMG &wmg)
+{
+    // time since the MPC problem was solved
+    int time_ms = (multirate_loop_index + 1) * wp.control_sampling_time_ms;
+
+    smpc::state_com CoM;
+    interpolateCoM (
+            multirate_CoM[0],
+            multirate_CoM[1],
+            wp.preview_sampling_time_sec,
+            (double) time_ms / wp.preview_sampling_time_ms,
+            CoM);
+
+    wmg.getFeetPositions (
+            time_ms,
+            nao.left_foot_posture.data(),
+            nao.right_foot_posture.data());
+
+    jointState current_target = nao.state_model;
+    solveIK (nao, mpc.hCoM, CoM);
+
+
+    // The joint angles are interpolated with a parabola passing through
+    // the targets of the previous, current and next control loops; the
+    // last DCM sample is the solution of IK.
+    jointState dcm_targets[2] = {nao.state_model, nao.state_model};
+    for (int j = 0; j < 2; j++)
+    {
+        double s = (double) (j + 1) * wp.dcm_sampling_time_ms / wp.control_sampling_time_ms;
+        double l_prev = s * (s - 1) / 2;
+        double l_cur = (1 - s) * (1 + s);
+        double l_next = s * (s + 1) / 2;
+
+        for (int i = 0; i < LOWER_JOINTS_NUM; i++)
+        {
+            dcm_targets[j].q[i] =
+                l_prev * multirate_last_target.q[i]
+                + l_cur * current_target.q[i]
+                + l_next * nao.state_model.q[i];
+        }
+    }
+    sendCommands (
+            dcm_targets[0],
+            dcm_targets[1],
+            last_dcm_time_ms + wp.dcm_sampling_time_ms,
+            wp.dcm_sampling_time_ms);
+
+
+    multirate_last_target = current_target;
+    multirate_loop_index = (multirate_loop_index + 1) % (wp.preview_sampling_time_ms / wp.control_sampling_time_ms);
+}
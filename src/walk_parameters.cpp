@@ -27,6 +27,11 @@ walkParameters::walkParameters(ALPtr<ALBroker> broker) :
      * the paper, we simply tuned it.
      */
     feedback_threshold = 0.004;
+    // The sensors show the position of the robot with a delay, the error
+    // is computed using the sensor data read the given time after the
+    // last commands were due (the data is interpolated). If it is 0, the
+    // latest sensor data is used.
+    feedback_delay_ms = 0;
 
 
 // parameters of the MPC solver
@@ -49,10 +54,25 @@ walkParameters::walkParameters(ALPtr<ALBroker> broker) :
     mpc_ip_bs_beta = 0.9;
     mpc_ip_max_iter = 5;
     mpc_ip_bs_type = smpc::SMPC_IP_BS_LOGBAR;
+    // Limit the number of iterations of the solver depending on the time
+    // left in the control loop instead of halting, when the loop is late.
+    mpc_anytime = false;
+    // Solve the same problems with the other type of the solver in a low
+    // priority thread and log the time and deviation of both solutions.
+    mpc_shadow = false;
+    // Take the solutions of the MPC problems from the table of explicit
+    // control laws (ORUW_EMPC_TABLE_FILE, see test/empc_table.cpp), if
+    // possible, the problems missing in the table are solved online.
+    mpc_lookup = false;
 
 
 // parameters of the walking pattern generator
     preview_window_size = 40;
+    // Shorten the preview window down to preview_window_min_size, when the
+    // control loop is close to loop_time_limit_ms, and restore it, when
+    // there is enough time.
+    preview_window_adaptive = false;
+    preview_window_min_size = 20;
     preview_sampling_time_ms = 40;
     preview_sampling_time_sec = (double) preview_sampling_time_ms / 1000;
 
@@ -95,14 +115,64 @@ walkParameters::walkParameters(ALPtr<ALBroker> broker) :
      */
     walk_control_thread_priority = 65; // constant
 
+    // lock memory and prefault workspaces before walking
+    walk_control_rt_mode = false;
+    // the control thread is bound to this CPU in the RT mode (-1 = any CPU);
+    // the control thread is created, when the module is loaded, hence the
+    // values of this parameter and walk_control_rt_mode at that moment
+    // determine the affinity.
+    walk_control_thread_cpu = -1;
+
+    control_scheduler = CONTROL_SCHEDULER_DCM;
+    // the deadlines of the control thread are shifted with respect to the 
+    // DCM cycles, so that the sensor data is already published.
+    control_wakeup_offset_ms = 2; // constant
+
+    // MPC and IK are executed in separate threads, the commands are delayed
+    // by one control period.
+    control_pipeline = false;
+
+    // The MPC problem is solved once per preview sampling period, IK -- once
+    // per control loop, the joint angles are interpolated to the DCM rate
+    // (control_pipeline and ik_parallel are ignored).
+    multi_rate = false;
+
     dcm_time_shift_ms = 0;
+
+    // Estimate the latency between the commands and the sensor readings
+    // online, the commands are sent ahead by the estimate (at most
+    // latency_max_ms), when its confidence is sufficient; a command is
+    // never moved before the next DCM cycle, so the first commands of a
+    // message are shifted less. dcm_time_shift_ms is ignored in this case.
+    latency_estimation = false;
+    latency_max_ms = 60;
+    latency_min_confidence = 0.8;
     dcm_sampling_time_ms = 10; // constant
 
+    // Use the simulated DCM instead of the DCM of NAOqi (read, when the
+    // module is loaded), the sensors report the commanded angles with the
+    // given delay.
+    simulated_dcm = false;
+    simulated_dcm_delay_ms = 10;
+
     control_sampling_time_ms = 20; // constant
+
+    // A watchdog thread holds the current posture and stops walking, if
+    // the DCM callback or the control loop is not executed within the
+    // given time.
+    watchdog = false;
+    watchdog_dcm_timeout_ms = 30;
+    watchdog_control_timeout_ms = 60;
     control_sampling_time_sec = (double) control_sampling_time_ms / 1000;
 
     loop_time_limit_ms = 15; // less than control_sampling_time_ms
 
+    // Adapt the limits on the number of iterations of the solvers, so that
+    // the 99th percentile of the loop time is below the given fraction of
+    // loop_time_limit_ms.
+    effort_control = false;
+    effort_target_ratio = 0.7;
+
 
     walk_pattern = WALK_PATTERN_STRAIGHT;
 
@@ -113,6 +183,13 @@ walkParameters::walkParameters(ALPtr<ALBroker> broker) :
     igm_tol = 0.0015;
     igm_max_iter = 20;
     igm_mu = 1.0;
+    // Solve IK problems for two control loops concurrently (ignored, when
+    // control_pipeline is enabled).
+    ik_parallel = false;
+    // The number of future samples of the MPC solution, for which IK is 
+    // solved; the joint angles are sent to the DCM in one message (0 -- 
+    // disabled, two commands are sent in separate messages).
+    command_horizon = 0;
 
 
 
@@ -162,6 +239,29 @@ walkParameters::walkParameters(ALPtr<ALBroker> broker) :
     param_names[STEP_PAIRS_NUMBER]        = "step_pairs_number";     
 
     param_names[WALK_PATTERN]             = "walk_pattern";     
+    param_names[CONTROL_SCHEDULER]        = "control_scheduler";
+    param_names[CONTROL_PIPELINE]         = "control_pipeline";
+    param_names[IK_PARALLEL]              = "ik_parallel";
+    param_names[WALK_CONTROL_RT_MODE]     = "walk_control_rt_mode";
+    param_names[WALK_CONTROL_THREAD_CPU]  = "walk_control_thread_cpu";
+    param_names[MPC_ANYTIME]              = "mpc_anytime";
+    param_names[EFFORT_CONTROL]           = "effort_control";
+    param_names[EFFORT_TARGET_RATIO]      = "effort_target_ratio";
+    param_names[MULTI_RATE]               = "multi_rate";
+    param_names[COMMAND_HORIZON]          = "command_horizon";
+    param_names[SIMULATED_DCM]            = "simulated_dcm";
+    param_names[SIMULATED_DCM_DELAY_MS]   = "simulated_dcm_delay_ms";
+    param_names[FEEDBACK_DELAY_MS]        = "feedback_delay_ms";
+    param_names[LATENCY_ESTIMATION]       = "latency_estimation";
+    param_names[LATENCY_MAX_MS]           = "latency_max_ms";
+    param_names[LATENCY_MIN_CONFIDENCE]   = "latency_min_confidence";
+    param_names[WATCHDOG]                 = "watchdog";
+    param_names[WATCHDOG_DCM_TIMEOUT_MS]  = "watchdog_dcm_timeout_ms";
+    param_names[WATCHDOG_CONTROL_TIMEOUT_MS] = "watchdog_control_timeout_ms";
+    param_names[MPC_SHADOW]               = "mpc_shadow";
+    param_names[MPC_LOOKUP]               = "mpc_lookup";
+    param_names[PREVIEW_WINDOW_ADAPTIVE]  = "preview_window_adaptive";
+    param_names[PREVIEW_WINDOW_MIN_SIZE]  = "preview_window_min_size";
 }
 
 
@@ -215,6 +315,8 @@ void walkParameters::readParameters()
             if(preferences[i][0] == param_names[BEZIER_WEIGHT_2])       { bezier_weight_2      = preferences[i][2]; }
             if(preferences[i][0] == param_names[BEZIER_INCLINATION_1])  { bezier_inclination_1 = preferences[i][2]; }
             if(preferences[i][0] == param_names[BEZIER_INCLINATION_2])  { bezier_inclination_2 = preferences[i][2]; }
+            if(preferences[i][0] == param_names[EFFORT_TARGET_RATIO]) { effort_target_ratio = preferences[i][2]; }
+            if(preferences[i][0] == param_names[LATENCY_MIN_CONFIDENCE]) { latency_min_confidence = preferences[i][2]; }
         }
         if (preferences[i][2].isInt())
         {
@@ -242,10 +344,31 @@ void walkParameters::readParameters()
 
             if(preferences[i][0] == param_names[DS_CONTROL_LOOPS])
                 {ds_time_ms = control_sampling_time_ms * (int) preferences[i][2];}
+            if(preferences[i][0] == param_names[CONTROL_SCHEDULER]) { control_scheduler = preferences[i][2]; }
+            if(preferences[i][0] == param_names[WALK_CONTROL_THREAD_CPU]) { walk_control_thread_cpu = preferences[i][2]; }
+            if(preferences[i][0] == param_names[COMMAND_HORIZON]) { command_horizon = preferences[i][2]; }
+            if(preferences[i][0] == param_names[SIMULATED_DCM_DELAY_MS]) { simulated_dcm_delay_ms = preferences[i][2]; }
+            if(preferences[i][0] == param_names[FEEDBACK_DELAY_MS]) { feedback_delay_ms = preferences[i][2]; }
+            if(preferences[i][0] == param_names[LATENCY_MAX_MS]) { latency_max_ms = preferences[i][2]; }
+            if(preferences[i][0] == param_names[WATCHDOG_DCM_TIMEOUT_MS]) { watchdog_dcm_timeout_ms = preferences[i][2]; }
+            if(preferences[i][0] == param_names[WATCHDOG_CONTROL_TIMEOUT_MS]) { watchdog_control_timeout_ms = preferences[i][2]; }
+            if(preferences[i][0] == param_names[PREVIEW_WINDOW_MIN_SIZE]) { preview_window_min_size = preferences[i][2]; }
         }
         if (preferences[i][2].isBool())
         {
             if(preferences[i][0] == param_names[MPC_AS_USE_DOWNDATE]) { mpc_as_use_downdate = preferences[i][2]; }
+            if(preferences[i][0] == param_names[CONTROL_PIPELINE]) { control_pipeline = preferences[i][2]; }
+            if(preferences[i][0] == param_names[IK_PARALLEL]) { ik_parallel = preferences[i][2]; }
+            if(preferences[i][0] == param_names[WALK_CONTROL_RT_MODE]) { walk_control_rt_mode = preferences[i][2]; }
+            if(preferences[i][0] == param_names[MPC_ANYTIME]) { mpc_anytime = preferences[i][2]; }
+            if(preferences[i][0] == param_names[EFFORT_CONTROL]) { effort_control = preferences[i][2]; }
+            if(preferences[i][0] == param_names[MULTI_RATE]) { multi_rate = preferences[i][2]; }
+            if(preferences[i][0] == param_names[SIMULATED_DCM]) { simulated_dcm = preferences[i][2]; }
+            if(preferences[i][0] == param_names[LATENCY_ESTIMATION]) { latency_estimation = preferences[i][2]; }
+            if(preferences[i][0] == param_names[WATCHDOG]) { watchdog = preferences[i][2]; }
+            if(preferences[i][0] == param_names[MPC_SHADOW]) { mpc_shadow = preferences[i][2]; }
+            if(preferences[i][0] == param_names[MPC_LOOKUP]) { mpc_lookup = preferences[i][2]; }
+            if(preferences[i][0] == param_names[PREVIEW_WINDOW_ADAPTIVE]) { preview_window_adaptive = preferences[i][2]; }
         }
     }
 }
@@ -311,6 +434,29 @@ void walkParameters::writeParameters()
     preferences[STEP_PAIRS_NUMBER][1]        = "";     
 
     preferences[WALK_PATTERN][1]             = "";     
+    preferences[CONTROL_SCHEDULER][1]        = "";
+    preferences[CONTROL_PIPELINE][1]         = "";
+    preferences[IK_PARALLEL][1]              = "";
+    preferences[WALK_CONTROL_RT_MODE][1]     = "";
+    preferences[WALK_CONTROL_THREAD_CPU][1]  = "";
+    preferences[MPC_ANYTIME][1]              = "";
+    preferences[EFFORT_CONTROL][1]           = "";
+    preferences[EFFORT_TARGET_RATIO][1]      = "";
+    preferences[MULTI_RATE][1]               = "";
+    preferences[COMMAND_HORIZON][1]          = "";
+    preferences[SIMULATED_DCM][1]            = "";
+    preferences[SIMULATED_DCM_DELAY_MS][1]   = "";
+    preferences[FEEDBACK_DELAY_MS][1]        = "";
+    preferences[LATENCY_ESTIMATION][1]       = "";
+    preferences[LATENCY_MAX_MS][1]           = "";
+    preferences[LATENCY_MIN_CONFIDENCE][1]   = "";
+    preferences[WATCHDOG][1]                 = "";
+    preferences[WATCHDOG_DCM_TIMEOUT_MS][1]  = "";
+    preferences[WATCHDOG_CONTROL_TIMEOUT_MS][1] = "";
+    preferences[MPC_SHADOW][1]               = "";
+    preferences[MPC_LOOKUP][1]               = "";
+    preferences[PREVIEW_WINDOW_ADAPTIVE][1]  = "";
+    preferences[PREVIEW_WINDOW_MIN_SIZE][1]  = "";
 
 
     // values
@@ -357,6 +503,29 @@ void walkParameters::writeParameters()
     preferences[STEP_PAIRS_NUMBER][2]        = step_pairs_number;
 
     preferences[WALK_PATTERN][2]             = walk_pattern;
+    preferences[CONTROL_SCHEDULER][2]        = control_scheduler;
+    preferences[CONTROL_PIPELINE][2]         = control_pipeline;
+    preferences[IK_PARALLEL][2]              = ik_parallel;
+    preferences[WALK_CONTROL_RT_MODE][2]     = walk_control_rt_mode;
+    preferences[WALK_CONTROL_THREAD_CPU][2]  = walk_control_thread_cpu;
+    preferences[MPC_ANYTIME][2]              = mpc_anytime;
+    preferences[EFFORT_CONTROL][2]           = effort_control;
+    preferences[EFFORT_TARGET_RATIO][2]      = effort_target_ratio;
+    preferences[MULTI_RATE][2]               = multi_rate;
+    preferences[COMMAND_HORIZON][2]          = command_horizon;
+    preferences[SIMULATED_DCM][2]            = simulated_dcm;
+    preferences[SIMULATED_DCM_DELAY_MS][2]   = simulated_dcm_delay_ms;
+    preferences[FEEDBACK_DELAY_MS][2]        = feedback_delay_ms;
+    preferences[LATENCY_ESTIMATION][2]       = latency_estimation;
+    preferences[LATENCY_MAX_MS][2]           = latency_max_ms;
+    preferences[LATENCY_MIN_CONFIDENCE][2]   = latency_min_confidence;
+    preferences[WATCHDOG][2]                 = watchdog;
+    preferences[WATCHDOG_DCM_TIMEOUT_MS][2]  = watchdog_dcm_timeout_ms;
+    preferences[WATCHDOG_CONTROL_TIMEOUT_MS][2] = watchdog_control_timeout_ms;
+    preferences[MPC_SHADOW][2]               = mpc_shadow;
+    preferences[MPC_LOOKUP][2]               = mpc_lookup;
+    preferences[PREVIEW_WINDOW_ADAPTIVE][2]  = preview_window_adaptive;
+    preferences[PREVIEW_WINDOW_MIN_SIZE][2]  = preview_window_min_size;
 
     try
     {
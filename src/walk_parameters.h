@@ -49,6 +49,15 @@ enum solverTypes
 };
 
 
+enum controlSchedulerTypes
+{
+    /// the control thread is woken up by the DCM callback
+    CONTROL_SCHEDULER_DCM = 0,
+    /// the control thread sleeps until absolute deadlines
+    CONTROL_SCHEDULER_DEADLINE = 1
+};
+
+
 enum parametersNames
 {
     FEEDBACK_GAIN               ,
@@ -92,6 +101,29 @@ enum parametersNames
 
     STEP_PAIRS_NUMBER           ,
     WALK_PATTERN                ,
+    CONTROL_SCHEDULER           ,
+    CONTROL_PIPELINE            ,
+    IK_PARALLEL                 ,
+    WALK_CONTROL_RT_MODE        ,
+    WALK_CONTROL_THREAD_CPU     ,
+    MPC_ANYTIME                 ,
+    EFFORT_CONTROL              ,
+    EFFORT_TARGET_RATIO         ,
+    MULTI_RATE                  ,
+    COMMAND_HORIZON             ,
+    SIMULATED_DCM               ,
+    SIMULATED_DCM_DELAY_MS      ,
+    FEEDBACK_DELAY_MS           ,
+    LATENCY_ESTIMATION          ,
+    LATENCY_MAX_MS              ,
+    LATENCY_MIN_CONFIDENCE      ,
+    WATCHDOG                    ,
+    WATCHDOG_DCM_TIMEOUT_MS     ,
+    WATCHDOG_CONTROL_TIMEOUT_MS ,
+    MPC_SHADOW                  ,
+    MPC_LOOKUP                  ,
+    PREVIEW_WINDOW_ADAPTIVE     ,
+    PREVIEW_WINDOW_MIN_SIZE     ,
 
     NUM_PARAMETERS              
 };
@@ -110,6 +142,7 @@ class walkParameters
 
         double feedback_gain;
         double feedback_threshold;
+        int feedback_delay_ms;
 
         int mpc_solver_type;
 
@@ -130,21 +163,42 @@ class walkParameters
         double mpc_ip_bs_beta;
         int mpc_ip_max_iter;
         int mpc_ip_bs_type;
+        bool mpc_anytime;
+        bool mpc_shadow;
+        bool mpc_lookup;
 
 
         double step_height;
         double step_length;
 
         int walk_control_thread_priority;
+        bool walk_control_rt_mode;
+        int walk_control_thread_cpu;
+        int control_scheduler;
+        int control_wakeup_offset_ms;
+        bool control_pipeline;
+        bool multi_rate;
 
         int dcm_sampling_time_ms;
         int dcm_time_shift_ms;
+        bool latency_estimation;
+        int latency_max_ms;
+        double latency_min_confidence;
+        bool simulated_dcm;
+        int simulated_dcm_delay_ms;
         int control_sampling_time_ms;
+        bool watchdog;
+        int watchdog_dcm_timeout_ms;
+        int watchdog_control_timeout_ms;
         double control_sampling_time_sec;
         int loop_time_limit_ms;
+        bool effort_control;
+        double effort_target_ratio;
         int preview_sampling_time_ms;
         double preview_sampling_time_sec;
         int preview_window_size;
+        bool preview_window_adaptive;
+        int preview_window_min_size;
 
         bool set_support_z_to_zero;
 
@@ -159,6 +213,8 @@ class walkParameters
         double igm_tol;
         int igm_max_iter;
         double igm_mu;
+        bool ik_parallel;
+        int command_horizon;
 
 
         double bezier_weight_1;
@@ -0,0 +1,147 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief Pausing and resuming of walking: the control thread is parked
+ * with its solver, WMG and MPC state, so that walking is resumed within
+ * one control period.
+ */
+
+#include <qi/os.hpp>
+
+#include "oru_walk.h"
+#include "oruw_log.h"
+
+
+/**
+ * @brief Stop sending commands and park the control thread, the robot
+ * holds the last commanded posture. Returns, when the control thread is
+ * parked.
+ */
+void oru_walk::pauseWalking()
+{
+    boost::mutex::scoped_lock lock(pause_mutex);
+
+    if (!walk_active || walk_paused)
+    {
+        return;
+    }
+
+    while (sem_trywait (&walk_parked_sem) == 0);
+    walk_paused = true;
+    __sync_synchronize();
+
+    robot_io->disconnectCallback();
+    stopWatchdog();
+    // wake up the control thread, if it waits for the DCM callback
+    sem_post (&walk_control_sem);
+
+    // the control thread finishes the current loop
+    while (sem_trywait (&walk_parked_sem) != 0)
+    {
+        if (!walk_active || walk_stop_requested)
+        {
+            // The walk is finished or stopped instead of being paused,
+            // stopWalking() may be waiting for the lock. The control
+            // thread is released, if it is parked anyway.
+            walk_paused = false;
+            sem_post (&walk_resume_sem);
+            return;
+        }
+        qi::os::msleep(1);
+    }
+
+    ORUW_LOG_MESSAGE("Walking is paused.\n");
+    qiLogInfo ("module.oru_walk", "Walking is paused.");
+}
+
+
+
+/**
+ * @brief Resume walking from the state, in which it was paused.
+ */
+void oru_walk::resumeWalking()
+{
+    bool connected = true;
+    {
+        boost::mutex::scoped_lock lock(pause_mutex);
+
+        // the stop is handled by stopWalking()
+        if (!walk_paused || walk_stop_requested)
+        {
+            return;
+        }
+
+        // the callback is disconnected and pauseWalking() has returned only
+        // after the control thread was parked
+        sensor_buffer.reset();
+        sensor_history.reset();
+        while (sem_trywait (&walk_control_sem) == 0);
+        // posted by stopWalking() after the previous walk was finished
+        while (sem_trywait (&walk_resume_sem) == 0);
+
+        walk_paused = false;
+        __sync_synchronize();
+        sem_post (&walk_resume_sem);
+
+        try
+        {
+            robot_io->connectCallback (boost::bind(&oru_walk::dcmCallback, this));
+            startWatchdog();
+        }
+        catch (const ALError &e)
+        {
+            ORUW_LOG_MESSAGE("Callback registration failed: %s\n", e.what());
+            connected = false;
+        }
+    }
+
+    // halt() calls stopWalking(), which acquires the lock
+    if (!connected)
+    {
+        halt("Callback registration failed!", __FUNCTION__);
+    }
+
+    ORUW_LOG_MESSAGE("Walking is resumed.\n");
+    qiLogInfo ("module.oru_walk", "Walking is resumed.");
+}
+
+
+
+/**
+ * @brief Park the control thread until walking is resumed or stopped.
+ *
+ * @return false if walking is stopped or the IK stage has failed.
+ */
+bool oru_walk::parkControlThread()
+{
+    if (wp.control_pipeline)
+    {
+        // the IK stage uses the sensor history, while it sends commands
+        while (!ik_tasks.isEmpty())
+        {
+            if (ik_stage_failed || walk_stop_requested)
+            {
+                // the queue is never drained, pauseWalking() returns,
+                // when the control loop is finished
+                return (false);
+            }
+            qi::os::msleep(1);
+        }
+    }
+
+    // pauseWalking() waits for this acknowledgement
+    sem_post (&walk_parked_sem);
+    while (sem_wait (&walk_resume_sem) != 0); // restart if interrupted
+
+    if (walk_stop_requested)
+    {
+        return (false);
+    }
+
+    control_scheduler.start(
+            wp.control_sampling_time_ms,
+            wp.control_wakeup_offset_ms,
+            robot_io->getCycleTime());
+    return (true);
+}
@@ -0,0 +1,170 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief The pipelined control loop: the MPC stage is executed in the walk
+ * control thread, the IK stage -- in a separate thread. While the IK
+ * problems of the control loop k are solved and the commands are sent, the
+ * MPC problem of the loop k+1 can be solved.
+ *
+ * Each stage has its own time budget (loop_time_limit_ms), hence the IK
+ * stage may finish after the first command is due. The commands are
+ * therefore delayed by the pipeline delay of one control period: they are
+ * stamped dcm_time + (i + 2) * control_sampling_time_ms instead of
+ * dcm_time + (i + 1) * control_sampling_time_ms.
+ */
+
+#include "oru_walk.h"
+#include "oruw_log.h"
+#include "oruw_timer.h"
+
+
+/**
+ * @brief Spawn the thread of the IK stage.
+ */
+void oru_walk::startIKStage()
+{
+    ik_tasks.reset();
+    ik_model_buffer.reset();
+    while (sem_trywait (&ik_stage_sem) == 0);
+    ik_stage_stop = false;
+    ik_stage_failed = false;
+
+    // the IK stage works with a copy of the model
+    nao_ik = nao;
+
+    try
+    {
+        ik_stage_thread = new boost::thread(&oru_walk::walkIKStage, this);
+        setThreadPriority (*ik_stage_thread, wp.walk_control_thread_priority);
+    }
+    catch (...)
+    {
+        halt("Failed to spawn the IK stage thread.\n", __FUNCTION__);
+    }
+}
+
+
+
+/**
+ * @brief Stop the thread of the IK stage and wait for its termination.
+ */
+void oru_walk::stopIKStage()
+{
+    if (ik_stage_thread != NULL)
+    {
+        ik_stage_stop = true;
+        sem_post (&ik_stage_sem);
+        ik_stage_thread->join();
+
+        delete ik_stage_thread;
+        ik_stage_thread = NULL;
+    }
+}
+
+
+
+/**
+ * @brief Pass the solution of the MPC problem to the IK stage.
+ *
+ * @param[in] mpc MPC parameters
+ * @param[in,out] wmg WMG
+ * @param[in] switch_support true if the support foot was switched.
+ */
+void oru_walk::pushIKTask (
+        const smpc_parameters &mpc,
+        WMG &wmg,
+        const bool switch_support)
+{
+    ikTask *task = ik_tasks.getBackSlot();
+    if (task == NULL)
+    {
+        halt("The IK stage is late.\n", __FUNCTION__);
+    }
+
+
+    for (int i = 0; i < 2; i++)
+    {
+        getMPCState (task->CoM[i], i);
+        wmg.getFeetPositions (
+                (i + 1) * wp.control_sampling_time_ms,
+                task->left_foot_posture[i].data(),
+                task->right_foot_posture[i].data());
+    }
+    task->hCoM = mpc.hCoM;
+    task->dcm_time_ms = last_dcm_time_ms;
+    task->switch_support = switch_support;
+
+    ik_tasks.push();
+    sem_post (&ik_stage_sem);
+}
+
+
+
+/**
+ * @brief The IK stage: solve IK problems and send commands.
+ * @attention REAL-TIME!
+ */
+void oru_walk::walkIKStage()
+{
+    oruw_timer timer(__FUNCTION__, wp.loop_time_limit_ms);
+
+    try
+    {
+        for (;;)
+        {
+            while (sem_wait (&ik_stage_sem) != 0); // restart if interrupted
+            if (ik_stage_stop)
+            {
+                break;
+            }
+
+
+            ikTask *task;
+            while ((task = ik_tasks.getFront()) != NULL)
+            {
+                if (task->switch_support)
+                {
+                    nao_ik.switchSupportFoot();
+                }
+
+                // only the most recent task is processed if the stage is late
+                if (!ik_tasks.isLast())
+                {
+                    ORUW_LOG_MESSAGE("IK stage: a task is skipped.\n");
+                    ik_tasks.pop();
+                    continue;
+                }
+
+
+                timer.reset();
+                for (int i = 0; i < 2; i++)
+                {
+                    nao_ik.left_foot_posture = task->left_foot_posture[i];
+                    nao_ik.right_foot_posture = task->right_foot_posture[i];
+
+                    solveIK (nao_ik, task->hCoM, task->CoM[i]);
+                    // the pipeline delay is one control period
+                    sendCommands (
+                            nao_ik.state_model,
+                            task->dcm_time_ms + (i + 2) * wp.control_sampling_time_ms,
+                            task->dcm_time_ms);
+                }
+                ik_tasks.pop();
+
+                // used in the MPC stage for support switching and logging
+                ik_model_buffer.getWriteSlot() = nao_ik.state_model;
+                ik_model_buffer.publish();
+
+                if (!timer.check())
+                {
+                    halt("Time limit is violated!\n", __FUNCTION__);
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        ik_stage_failed = true;
+    }
+}
@@ -0,0 +1,188 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief Real-time hardening of the walk control thread: memory locking,
+ * prefaulting, CPU affinity and statistics.
+ */
+
+#include <sys/mman.h> // mlockall
+#include <sys/resource.h> // getrusage
+#include <sched.h> // CPU_SET
+
+#include "oru_walk.h"
+#include "oruw_log.h"
+
+
+/**
+ * The size of the stack of the control thread, which is touched before
+ * the first control loop.
+ */
+#define ORUW_PREFAULT_STACK_SIZE (256*1024)
+
+
+
+/**
+ * @brief Lock all current and future pages of the process in memory.
+ * @attention Memory is never unlocked.
+ */
+void oru_walk::lockMemory()
+{
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        // Assume that this error is not critical
+        ORUW_LOG_MESSAGE("Cannot lock memory: %s\n", strerror(errno));
+    }
+}
+
+
+
+/**
+ * @brief Bind a thread to a CPU.
+ *
+ * @param[in,out] thread the thread
+ * @param[in] cpu number of the CPU
+ */
+void oru_walk::setThreadAffinity(boost::thread &thread, const int cpu)
+{
+    cpu_set_t cpu_set;
+
+    CPU_ZERO (&cpu_set);
+    CPU_SET (cpu, &cpu_set);
+    int retval = pthread_setaffinity_np(
+            thread.native_handle(),
+            sizeof(cpu_set),
+            &cpu_set);
+    if (retval != 0)
+    {
+        // Assume that this error is not critical
+        ORUW_LOG_MESSAGE("Cannot change the affinity of a thread: %s\n", strerror(retval));
+    }
+}
+
+
+
+/**
+ * @brief Touch the stack of the calling thread, so that the pages are
+ * mapped before the control loop is started.
+ */
+void oru_walk::prefaultStack()
+{
+    volatile char stack[ORUW_PREFAULT_STACK_SIZE];
+
+    for (int i = 0; i < ORUW_PREFAULT_STACK_SIZE; i += 1024)
+    {
+        stack[i] = 0;
+    }
+    stack[0] = stack[ORUW_PREFAULT_STACK_SIZE - 1024];
+}
+
+
+
+/**
+ * @brief Solve one MPC problem and one IK problem in a dry run, so that the
+ * workspaces of the solver and the code are mapped before the control loop
+ * is started. The state of the module is not changed.
+ */
+void oru_walk::prefaultWorkspaces()
+{
+    nao_igm nao_saved = nao;
+
+
+    WMG wmg(wp.preview_window_size,
+            wp.preview_sampling_time_ms,
+            wp.step_height,
+            wp.bezier_weight_1,
+            wp.bezier_weight_2,
+            wp.bezier_inclination_1,
+            wp.bezier_inclination_2);
+    // the same sampling as in walkControl()
+    if (wp.multi_rate)
+    {
+        wmg.T_ms[0] = wp.preview_sampling_time_ms;
+        wmg.T_ms[1] = wp.preview_sampling_time_ms;
+    }
+    else
+    {
+        wmg.T_ms[0] = wp.control_sampling_time_ms;
+        wmg.T_ms[1] = wp.control_sampling_time_ms;
+    }
+
+    initWalkPattern(wmg);
+
+
+    nao.getCoM (nao.state_sensor, nao.CoM_position);
+    smpc_parameters mpc(wp.preview_window_size, nao.CoM_position[2]);
+    mpc.init_state.set (nao.CoM_position[0], nao.CoM_position[1]);
+
+    if (wmg.formPreviewWindow(mpc) != WMG_HALT)
+    {
+        // the solvers for the shorter preview windows use its beginning
+        for (int i = ORUW_HORIZON_LEVELS - 1; i > 0; i--)
+        {
+            if (solver_horizon[i] != NULL)
+            {
+                solver = solver_horizon[i];
+                solver->set_parameters (mpc.T, mpc.h, mpc.h[0], mpc.angle, mpc.zref_x, mpc.zref_y, mpc.lb, mpc.ub);
+                solver->form_init_fp (mpc.fp_x, mpc.fp_y, mpc.init_state, mpc.X);
+                solver->solve();
+            }
+        }
+        // all solvers of the anytime mode are touched
+        for (int i = ORUW_SOLVER_LADDER_SIZE - 1; i >= 0; i--)
+        {
+            if (solver_ladder[i] != NULL)
+            {
+                solver = solver_ladder[i];
+                solver->set_parameters (mpc.T, mpc.h, mpc.h[0], mpc.angle, mpc.zref_x, mpc.zref_y, mpc.lb, mpc.ub);
+                solver->form_init_fp (mpc.fp_x, mpc.fp_y, mpc.init_state, mpc.X);
+                solver->solve();
+            }
+        }
+
+        smpc::state_com CoM;
+        solver->get_state(CoM, 0);
+        wmg.getFeetPositions (
+                wp.control_sampling_time_ms,
+                nao.left_foot_posture.data(),
+                nao.right_foot_posture.data());
+        nao.setCoM(CoM.x(), CoM.y(), mpc.hCoM);
+        nao.igm (ref_joint_angles, wp.igm_mu, wp.igm_tol, wp.igm_max_iter);
+    }
+
+    nao = nao_saved;
+}
+
+
+
+/**
+ * @brief Remember resource usage of the control thread at the beginning
+ * of the walk.
+ */
+void oru_walk::startRUsage()
+{
+    getrusage (RUSAGE_THREAD, &walk_rusage);
+}
+
+
+
+/**
+ * @brief Log the number of page faults and context switches in the
+ * control thread since startRUsage() was called.
+ */
+void oru_walk::logRUsage()
+{
+    struct rusage now;
+    getrusage (RUSAGE_THREAD, &now);
+
+    ORUW_LOG_MESSAGE("Page faults: minor = %ld // major = %ld\n",
+            now.ru_minflt - walk_rusage.ru_minflt,
+            now.ru_majflt - walk_rusage.ru_majflt);
+    ORUW_LOG_MESSAGE("Context switches: voluntary = %ld // involuntary = %ld\n",
+            now.ru_nvcsw - walk_rusage.ru_nvcsw,
+            now.ru_nivcsw - walk_rusage.ru_nivcsw);
+    qiLogInfo ("module.oru_walk") << "Walk control thread: page faults = "
+        << now.ru_minflt - walk_rusage.ru_minflt + now.ru_majflt - walk_rusage.ru_majflt
+        << ", context switches = "
+        << now.ru_nvcsw - walk_rusage.ru_nvcsw + now.ru_nivcsw - walk_rusage.ru_nivcsw;
+}
@@ -0,0 +1,238 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief The shadow mode: the MPC problems are also solved by the solver of
+ * the other type in a low priority thread, the time, the number of
+ * iterations and the deviation of both solutions are logged to
+ * oru_shadow.log. The shadow solution is never used for control.
+ */
+
+#include <cmath> // sqrt
+#include <cstring> // strerror
+#include <pthread.h>
+
+#include "oru_walk.h"
+#include "oruw_log.h"
+#include "oruw_timer.h"
+
+
+/**
+ * @brief Get the number of iterations performed by a solver in the last
+ * solution.
+ *
+ * @param[in] solver the solver
+ * @param[in] solver_type type of the solver
+ *
+ * @return the number of activated and deactivated constraints (AS) or the
+ * number of internal iterations (IP).
+ */
+static int getSolverIterations (smpc::solver *solver, const int solver_type)
+{
+    if (solver_type == SOLVER_TYPE_AS)
+    {
+        smpc::solver_as * solver_ptr = dynamic_cast<smpc::solver_as *>(solver);
+        if (solver_ptr != NULL)
+        {
+            return (solver_ptr->added_constraints_num + solver_ptr->removed_constraints_num);
+        }
+    }
+    else if (solver_type == SOLVER_TYPE_IP)
+    {
+        smpc::solver_ip * solver_ptr = dynamic_cast<smpc::solver_ip *>(solver);
+        if (solver_ptr != NULL)
+        {
+            return (solver_ptr->int_loop_iterations);
+        }
+    }
+    return (0);
+}
+
+
+
+/**
+ * @brief Move a thread to the normal (not real-time) scheduling policy.
+ *
+ * @param[in,out] thread the thread
+ */
+static void setNormalPriority (boost::thread &thread)
+{
+    struct sched_param thread_sched;
+
+    thread_sched.sched_priority = 0;
+    int retval = pthread_setschedparam(
+            thread.native_handle(),
+            SCHED_OTHER,
+            &thread_sched);
+    if (retval != 0)
+    {
+        ORUW_LOG_MESSAGE("Cannot change the priority of a thread: %s\n", strerror(retval));
+    }
+}
+
+
+
+/**
+ * @brief Start the shadow thread, must be called before the control loop.
+ * The thread is not real-time, i.e. it runs only when the control thread
+ * sleeps. It is spawned by the control thread and would inherit its
+ * SCHED_FIFO policy, hence the policy is set explicitly.
+ */
+void oru_walk::startShadowSolver()
+{
+    shadow_tick_num = 0;
+    shadow_skipped_num = 0;
+    shadow_solved_num = 0;
+    shadow_primary_time_sum = 0.0;
+    shadow_time_sum = 0.0;
+    shadow_max_deviation = 0.0;
+
+    if (!wp.mpc_shadow)
+    {
+        return;
+    }
+
+    shadow_solver_type = (wp.mpc_solver_type == SOLVER_TYPE_AS) ? SOLVER_TYPE_IP : SOLVER_TYPE_AS;
+    shadow_solver = getSolver (shadow_solver_type, wp.preview_window_size, 0);
+    shadow_mpc = new smpc_parameters (wp.preview_window_size, nao.CoM_position[2]);
+    setNormalPriority (shadow_worker.start (boost::bind(&oru_walk::solveShadowProblem, this)));
+}
+
+
+
+/**
+ * @brief Stop the shadow thread and log the summary.
+ */
+void oru_walk::stopShadowSolver()
+{
+    shadow_worker.stop();
+    if (shadow_mpc == NULL)
+    {
+        return;
+    }
+    delete shadow_mpc;
+    shadow_mpc = NULL;
+
+    ORUW_LOG_MESSAGE("Shadow solver: compared = %d // skipped = %d // max deviation = %f\n",
+            shadow_solved_num, shadow_skipped_num, shadow_max_deviation);
+    if (shadow_solved_num > 0)
+    {
+        ORUW_LOG_MESSAGE("Shadow solver: mean time (ms) primary = %f // shadow = %f\n",
+                shadow_primary_time_sum * 1000 / shadow_solved_num,
+                shadow_time_sum * 1000 / shadow_solved_num);
+        qiLogInfo ("module.oru_walk") << "Shadow solver: mean time (ms) primary = "
+            << shadow_primary_time_sum * 1000 / shadow_solved_num
+            << " / shadow = " << shadow_time_sum * 1000 / shadow_solved_num
+            << ", max deviation = " << shadow_max_deviation;
+    }
+}
+
+
+
+/**
+ * @brief Copy the MPC problem for the shadow solver, must be called before
+ * the primary solver changes the initial state.
+ *
+ * @param[in] mpc MPC parameters
+ *
+ * @return false if the shadow mode is disabled, the previous problem
+ * is still being solved or the preview window is shortened (the tick is
+ * skipped).
+ */
+bool oru_walk::prepareShadowProblem (const smpc_parameters &mpc)
+{
+    if (!wp.mpc_shadow)
+    {
+        return (false);
+    }
+
+    ++shadow_tick_num;
+    if ((horizon_level > 0) || !shadow_worker.isDone())
+    {
+        ++shadow_skipped_num;
+        return (false);
+    }
+
+    for (int i = 0; i < wp.preview_window_size; i++)
+    {
+        shadow_mpc->T[i] = mpc.T[i];
+        shadow_mpc->h[i] = mpc.h[i];
+        shadow_mpc->angle[i] = mpc.angle[i];
+        shadow_mpc->zref_x[i] = mpc.zref_x[i];
+        shadow_mpc->zref_y[i] = mpc.zref_y[i];
+        shadow_mpc->fp_x[i] = mpc.fp_x[i];
+        shadow_mpc->fp_y[i] = mpc.fp_y[i];
+    }
+    for (int i = 0; i < 2 * wp.preview_window_size; i++)
+    {
+        shadow_mpc->lb[i] = mpc.lb[i];
+        shadow_mpc->ub[i] = mpc.ub[i];
+    }
+    shadow_mpc->hCoM = mpc.hCoM;
+    shadow_mpc->init_state = mpc.init_state;
+
+    return (true);
+}
+
+
+
+/**
+ * @brief Pass the results of the primary solver to the shadow thread and
+ * start solving of the copied problem.
+ *
+ * @param[in] next_state the next state obtained by the primary solver
+ * @param[in] solve_time time spent by the primary solver (in seconds)
+ */
+void oru_walk::postShadowProblem (const smpc::state_com &next_state, const double solve_time)
+{
+    shadow_primary_state = next_state;
+    shadow_primary_time = solve_time;
+    shadow_primary_iterations = getSolverIterations (solver, wp.mpc_solver_type);
+    shadow_primary_tick = shadow_tick_num;
+
+    shadow_worker.post();
+}
+
+
+
+/**
+ * @brief The job of the shadow thread.
+ */
+void oru_walk::solveShadowProblem()
+{
+    oruw_timer timer(__FUNCTION__, wp.loop_time_limit_ms);
+
+    shadow_solver->set_parameters (
+            shadow_mpc->T, shadow_mpc->h, shadow_mpc->h[0], shadow_mpc->angle,
+            shadow_mpc->zref_x, shadow_mpc->zref_y, shadow_mpc->lb, shadow_mpc->ub);
+    shadow_solver->form_init_fp (shadow_mpc->fp_x, shadow_mpc->fp_y, shadow_mpc->init_state, shadow_mpc->X);
+    shadow_solver->solve();
+    shadow_solver->get_next_state(shadow_mpc->init_state);
+
+    double shadow_time = timer.elapsed();
+
+
+    double deviation = 0.0;
+    for (int i = 0; i < SMPC_NUM_STATE_VAR; i++)
+    {
+        double diff = shadow_mpc->init_state.state_vector[i] - shadow_primary_state.state_vector[i];
+        deviation += diff * diff;
+    }
+    deviation = sqrt (deviation);
+
+
+    ++shadow_solved_num;
+    shadow_primary_time_sum += shadow_primary_time;
+    shadow_time_sum += shadow_time;
+    if (deviation > shadow_max_deviation)
+    {
+        shadow_max_deviation = deviation;
+    }
+
+    // tick, type, time (ms), iterations of the primary, then of the shadow solver; deviation
+    ORUW_LOG_SHADOW("%d    %d %f %d    %d %f %d    %e\n",
+            shadow_primary_tick,
+            wp.mpc_solver_type, shadow_primary_time * 1000, shadow_primary_iterations,
+            shadow_solver_type, shadow_time * 1000, getSolverIterations (shadow_solver, shadow_solver_type),
+            deviation);
+}
@@ -0,0 +1,157 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief A watchdog thread, which monitors the DCM callback and the
+ * control thread and stops the robot, if one of them misses a deadline.
+ */
+
+#include "oru_walk.h"
+#include "oruw_log.h"
+#include "oruw_scheduler.h"
+
+
+
+/**
+ * @brief Start the watchdog thread, must be called after the DCM callback
+ * is connected.
+ */
+void oru_walk::startWatchdog()
+{
+    stopWatchdog();
+
+    boost::mutex::scoped_lock lock(watchdog_mutex);
+    watchdog_triggered = false;
+    if (!wp.watchdog)
+    {
+        return;
+    }
+
+    control_heartbeat = 0;
+    watchdog_stop = false;
+    watchdog_thread = new boost::thread(&oru_walk::watchdog, this);
+    // the watchdog must preempt the control thread
+    setThreadPriority (*watchdog_thread, wp.walk_control_thread_priority + 1);
+}
+
+
+
+/**
+ * @brief Stop the watchdog thread and wait for its termination, must not
+ * be called by the watchdog itself.
+ */
+void oru_walk::stopWatchdog()
+{
+    boost::mutex::scoped_lock lock(watchdog_mutex);
+
+    if (watchdog_thread == NULL)
+    {
+        return;
+    }
+
+    watchdog_stop = true;
+    watchdog_thread->join();
+    delete watchdog_thread;
+    watchdog_thread = NULL;
+}
+
+
+
+/**
+ * @brief The loop of the watchdog: the heartbeats are checked in the
+ * middle of each DCM period. The time between the expiration of a
+ * deadline and sending of the safe command is reported as the reaction
+ * time.
+ */
+void oru_walk::watchdog()
+{
+    oruw_scheduler scheduler;
+    scheduler.start (wp.dcm_sampling_time_ms, wp.dcm_sampling_time_ms / 2, robot_io->getCycleTime());
+
+    int last_dcm_counter = dcm_loop_counter;
+    int last_control_heartbeat = control_heartbeat;
+    double last_dcm_beat_ms = oruw_scheduler::getMonotonicTimeMs();
+    double last_control_beat_ms = last_dcm_beat_ms;
+
+    while (!watchdog_stop)
+    {
+        scheduler.wait (robot_io->getCycleTime());
+        double now_ms = oruw_scheduler::getMonotonicTimeMs();
+
+        if (dcm_loop_counter != last_dcm_counter)
+        {
+            last_dcm_counter = dcm_loop_counter;
+            last_dcm_beat_ms = now_ms;
+        }
+        if (control_heartbeat != last_control_heartbeat)
+        {
+            last_control_heartbeat = control_heartbeat;
+            last_control_beat_ms = now_ms;
+        }
+
+
+        const char *reason = NULL;
+        double deadline_ms = now_ms;
+        if (now_ms - last_dcm_beat_ms > wp.watchdog_dcm_timeout_ms)
+        {
+            reason = "Watchdog: the DCM callback missed the deadline.\n";
+            deadline_ms = last_dcm_beat_ms + wp.watchdog_dcm_timeout_ms;
+        }
+        // the control thread is monitored after its first loop, since the
+        // initialization may take longer
+        else if ((last_control_heartbeat > 0)
+                && (now_ms - last_control_beat_ms > wp.watchdog_control_timeout_ms))
+        {
+            reason = "Watchdog: the control thread missed the deadline.\n";
+            deadline_ms = last_control_beat_ms + wp.watchdog_control_timeout_ms;
+        }
+
+        if (reason != NULL)
+        {
+            sendSafeCommands();
+            double reaction_ms = oruw_scheduler::getMonotonicTimeMs() - deadline_ms;
+
+            // the thread is joined by the next stopWatchdog()
+            requestStop (reason);
+            ORUW_LOG_MESSAGE("Watchdog reaction time: %f ms\n", reaction_ms);
+            qiLogInfo ("module.oru_walk") << "Watchdog reaction time: " << reaction_ms << " ms";
+            break;
+        }
+    }
+}
+
+
+
+/**
+ * @brief Hold the last measured posture of the lower body. The commands
+ * are preallocated, the control thread is not allowed to send commands
+ * after this.
+ */
+void oru_walk::sendSafeCommands()
+{
+    watchdog_triggered = true;
+    __sync_synchronize();
+
+    int dcm_time_ms;
+    if (sensor_history.getLatestTime (dcm_time_ms)
+            && sensor_history.getSnapshot (dcm_time_ms, safe_sensors))
+    {
+        safe_sensors.getJointState (safe_joint_state);
+    }
+    else
+    {
+        // 'nao' is owned by the control thread
+        safe_posture_buffer.update();
+        safe_joint_state = safe_posture_buffer.getReadSlot();
+    }
+
+    try
+    {
+        safe_commands.set (0, robot_io->getCycleTime() + wp.dcm_sampling_time_ms, safe_joint_state);
+        robot_io->setAlias (safe_commands.commands);
+    }
+    catch (const AL::ALError &e)
+    {
+        ORUW_LOG_MESSAGE("Cannot send the safe commands: %s", e.what());
+    }
+}
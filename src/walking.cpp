@@ -5,9 +5,12 @@
  * @author Alexander Sherikov
  */
 
+#include <algorithm> // max
+
 #include "oru_walk.h"
 #include "oruw_log.h"
 #include "oruw_timer.h"
+#include "oruw_alloc.h"
 
 
 /**
@@ -16,67 +19,185 @@
  */
 void oru_walk::walk()
 {
+    if (walk_paused)
+    {
+        ORUW_THROW("Walking is paused, it must be resumed or stopped.");
+    }
+    if (walk_active && !walk_stop_requested)
+    {
+        ORUW_THROW("Walking is in progress.");
+    }
+    // the stopped walk finishes within one control period
+    control_worker.wait();
+    if (control_worker.failed)
+    {
+        // the control thread is reused, the failure is only reported
+        ORUW_LOG_MESSAGE("The previous walk has failed.\n");
+        qiLogInfo ("module.oru_walk", "The previous walk has failed.");
+    }
+
     ORUW_LOG_OPEN;
     wp.readParameters();
+    if (wp.multi_rate)
+    {
+        if ((wp.preview_sampling_time_ms % wp.control_sampling_time_ms) != 0)
+        {
+            halt("The preview sampling time must be a multiple of the control sampling time.\n", __FUNCTION__);
+        }
+        // IK is solved once per control loop
+        wp.control_pipeline = false;
+        wp.ik_parallel = false;
+    }
+    if (wp.command_horizon > 0)
+    {
+        if ((wp.command_horizon < 2) || (wp.command_horizon > wp.preview_window_size))
+        {
+            halt("The command horizon must be in the range [2, preview_window_size].\n", __FUNCTION__);
+        }
+        joint_commands_horizon.init ("lowerJointActuator", wp.command_horizon);
+    }
 
-
-    // initialize Nao model
-    readSensors(nao.state_sensor);
+    if (wp.walk_control_rt_mode)
+    {
+        lockMemory();
+    }
 
 
-    // start walk control thread
-    try
+    // wait for the asynchronous commands (stiffness, initial position),
+    // the mutex is not held while waiting
+    for (;;)
     {
-        boost::thread walk_control_thread(&oru_walk::walkControl, this);
-        struct sched_param walk_control_thread_sched;
-
-        walk_control_thread_sched.sched_priority = wp.walk_control_thread_priority;
-        int retval = pthread_setschedparam(
-                walk_control_thread.native_handle(), 
-                SCHED_FIFO, 
-                &walk_control_thread_sched);
-        if (retval != 0)
+        int completion_time_ms;
         {
-            // Assume that this error is not critical
-            ORUW_LOG_MESSAGE("Cannot change the priority of the walk control thread: %s\n", strerror(retval));
+            boost::mutex::scoped_lock lock(completion_mutex);
+            if (!pending_completion)
+            {
+                break;
+            }
+            completion_time_ms = pending_completion_time_ms;
         }
 
-        walk_control_thread.detach();
-    }
-    catch (...)
-    {
-        halt("Failed to spawn the walk control thread.\n", __FUNCTION__);
+        waitCompletion (completion_time_ms);
+
+        {
+            boost::mutex::scoped_lock lock(completion_mutex);
+            // a later command may have been issued while waiting
+            if (pending_completion_time_ms == completion_time_ms)
+            {
+                pending_completion = false;
+            }
+        }
     }
 
 
+    // initialize Nao model
+    readSensors(sensors);
+    sensors.getJointState(nao.state_sensor);
+    last_dcm_time_ms = sensors.dcm_time_ms;
+    last_command_time_ms = last_dcm_time_ms;
+
+    // drop the data left from the previous walk
+    sensor_buffer.reset();
+    sensor_history.reset();
+    // the initial posture is held, until the first commands are sent
+    safe_posture_buffer.reset();
+    safe_posture_buffer.getWriteSlot() = nao.state_sensor;
+    safe_posture_buffer.publish();
+    initLatencyEstimation();
+    while (sem_trywait (&walk_control_sem) == 0);
+    while (sem_trywait (&walk_resume_sem) == 0);
+    while (sem_trywait (&walk_parked_sem) == 0);
+
+
+    walk_stop_requested = false;
+
+
     // register callback
     dcm_loop_counter = 0;
     try
     {
-        dcm_callback_connection =
-            getParentBroker()->getProxy("DCM")->getModule()->atPostProcess
-            (boost::bind(&oru_walk::dcmCallback, this));
+        robot_io->connectCallback (boost::bind(&oru_walk::dcmCallback, this));
     }
     catch (const ALError &e)
     {
         ORUW_LOG_MESSAGE("Callback registration failed: %s\n", e.what());
         halt("Callback registration failed!", __FUNCTION__);
     }
+
+    try
+    {
+        startWatchdog();
+    }
+    catch (...)
+    {
+        halt("Failed to spawn the watchdog thread.\n", __FUNCTION__);
+    }
+
+
+    // start walk control loop in the control thread, it is started last,
+    // since it stops the callback and the watchdog on exit
+    walk_active = true;
+    control_worker.post();
+
+    if (first_walk)
+    {
+        first_walk = false;
+        qiLogInfo ("module.oru_walk") << "Startup: the first walk is started after "
+            << startup_timer.elapsed() * 1000 << " ms";
+    }
 }
 
 
 
 /**
- * @brief Update joint angles.
+ * @brief Wait until the control loop of the current walk is finished.
  */
-void oru_walk::readSensors(jointState& joint_state)
+void oru_walk::waitWalking()
 {
-    vector<float> sensorValues;
+    control_worker.wait();
+    if (control_worker.failed)
+    {
+        ORUW_THROW("The walk has failed.");
+    }
+}
+
+
+
+/**
+ * @brief Change scheduling policy of a thread to SCHED_FIFO.
+ *
+ * @param[in,out] thread the thread
+ * @param[in] priority priority
+ */
+void oru_walk::setThreadPriority(boost::thread &thread, const int priority)
+{
+    struct sched_param thread_sched;
+
+    thread_sched.sched_priority = priority;
+    int retval = pthread_setschedparam(
+            thread.native_handle(), 
+            SCHED_FIFO, 
+            &thread_sched);
+    if (retval != 0)
+    {
+        // Assume that this error is not critical
+        ORUW_LOG_MESSAGE("Cannot change the priority of a thread: %s\n", strerror(retval));
+    }
+}
+
 
-    access_sensor_values->GetValues (sensorValues);
-    for (int i = 0; i < JOINTS_NUM; i++)
+
+/**
+ * @brief Read all sensors and the DCM time at once.
+ *
+ * @param[out] snapshot sensor data
+ */
+void oru_walk::readSensors(sensorSnapshot& snapshot)
+{
+    robot_io->readSensors (sensor_values, snapshot.dcm_time_ms);
+    for (int i = 0; i < SENSORS_NUM; i++)
     {
-        joint_state.q[i] = sensorValues[i];
+        snapshot.values[i] = sensor_values[i];
     }
     /* Acc. to the documentation:
      * "LHipYawPitch and RHipYawPitch share the same motor so they move
@@ -84,30 +205,119 @@ void oru_walk::readSensors(jointState& joint_state)
      *  LHipYawPitch always takes the priority."
      * Make sure that these joint angles are equal:
      */
-    joint_state.q[R_HIP_YAW_PITCH] = joint_state.q[L_HIP_YAW_PITCH];
+    snapshot.values[R_HIP_YAW_PITCH] = snapshot.values[L_HIP_YAW_PITCH];
 }
 
 
 
 /**
- * @brief Wake up walk control thread periodically.
+ * @brief Publish sensor data and wake up walk control thread periodically.
+ * @attention REAL-TIME! No locks here: the DCM thread must never wait for 
+ * the control thread.
  */
 void oru_walk::dcmCallback()
 {
     dcm_loop_counter++;
-    if (dcm_loop_counter % (wp.control_sampling_time_ms / wp.dcm_sampling_time_ms) == 0)
+
+    sensorSnapshot &snapshot = sensor_history.getWriteSlot();
+    readSensors (snapshot);
+    sensor_history.publish();
+
+    if (wp.control_scheduler == CONTROL_SCHEDULER_DEADLINE)
+    {
+        // the control thread wakes up on its own and needs fresh data
+        sensor_buffer.getWriteSlot() = snapshot;
+        sensor_buffer.publish();
+    }
+    else if (dcm_loop_counter % (wp.control_sampling_time_ms / wp.dcm_sampling_time_ms) == 0)
+    {
+        sensor_buffer.getWriteSlot() = snapshot;
+        sensor_buffer.publish();
+
+        sem_post (&walk_control_sem);
+    }
+}
+
+
+
+/**
+ * @brief The job of the control thread: one walk. The callback and the
+ * watchdog are stopped on all exits of the control loop.
+ */
+void oru_walk::walkControlJob()
+{
+    bool failed = false;
+    try
+    {
+        walkControl();
+    }
+    catch (...)
+    {
+        failed = true;
+    }
+
+    if (!walk_stop_requested)
     {
-        last_dcm_time_ms = *last_dcm_time_ms_ptr + wp.dcm_time_shift_ms;
-        readSensors (nao.state_sensor);
+        stopWalking ("The control loop is terminated.\n");
+    }
+    walk_active = false;
 
-        boost::mutex::scoped_lock lock(walk_control_mutex);
-        walk_control_condition.notify_one();
-        lock.unlock();
+    if (failed)
+    {
+        ORUW_THROW("The control loop has failed.");
     }
 }
 
 
 
+/**
+ * @brief Wait for the next wake up signal from the DCM callback or for the
+ * next deadline, and fetch the most recent sensor data.
+ *
+ * @return false if no new data was published.
+ */
+bool oru_walk::waitForSensors()
+{
+    if (wp.control_scheduler == CONTROL_SCHEDULER_DEADLINE)
+    {
+        int missed_periods = control_scheduler.wait(robot_io->getCycleTime());
+        ORUW_LOG_MESSAGE("Wake up jitter: %f ms\n", control_scheduler.last_jitter_ms);
+        if (missed_periods > 0)
+        {
+            ORUW_LOG_MESSAGE("Missed periods: %d\n", missed_periods);
+        }
+    }
+    else
+    {
+        while (sem_wait (&walk_control_sem) != 0); // restart if interrupted
+
+        // the control thread was late, skip the missed signals
+        int missed_signals = 0;
+        while (sem_trywait (&walk_control_sem) == 0)
+        {
+            ++missed_signals;
+        }
+        if (missed_signals > 0)
+        {
+            ORUW_LOG_MESSAGE("Missed wake up signals: %d\n", missed_signals);
+        }
+    }
+
+
+    if (!sensor_buffer.update())
+    {
+        return (false);
+    }
+    sensors = sensor_buffer.getReadSlot();
+    sensors.getJointState (nao.state_sensor);
+    last_dcm_time_ms = sensors.dcm_time_ms;
+    ORUW_LOG_SENSORS(sensors);
+
+    return (true);
+}
+
+
+
 /**
  * @brief The position of the next support foot may change from the targeted, 
  * this function moves it to the right place.
@@ -121,32 +331,35 @@ void oru_walk::correctNextSupportPosition(WMG &wmg)
 
 
 /**
- * @brief Initialize solver
+ * @brief Create a solver.
+ *
+ * @param[in] solver_type type of the solver (SOLVER_TYPE_AS or SOLVER_TYPE_IP)
+ * @param[in] N the length of the preview window
+ * @param[in] level the number of times the limit on the number of
+ * iterations (IP) or activated constraints (AS) is halved, 0 -- the
+ * limit is taken from the parameters.
+ *
+ * @return a new solver.
  */
-void oru_walk::initSolver()
+smpc::solver * oru_walk::createSolver(const int solver_type, const int N, const int level)
 {
-    if (solver != NULL)
+    if (solver_type == SOLVER_TYPE_AS)
     {
-        delete solver;
-        solver = NULL;
-    }
-    if (wp.mpc_solver_type == SOLVER_TYPE_AS)
-    {
-        solver = new smpc::solver_as (
-                wp.preview_window_size,
+        return (new smpc::solver_as (
+                N,
                 wp.mpc_gain_position,
                 wp.mpc_gain_velocity,
                 wp.mpc_gain_acceleration,
                 wp.mpc_gain_jerk,
                 wp.mpc_as_tolerance,
-                wp.mpc_as_max_activate,
+                (level == 0) ? wp.mpc_as_max_activate : max (1, wp.mpc_as_max_activate >> level),
                 wp.mpc_as_use_downdate,
-                false); // objective
+                false)); // objective
     }
-    else if (wp.mpc_solver_type == SOLVER_TYPE_IP)
+    else if (solver_type == SOLVER_TYPE_IP)
     {
-        solver = new smpc::solver_ip (
-                wp.preview_window_size,
+        return (new smpc::solver_ip (
+                N,
                 wp.mpc_gain_position,
                 wp.mpc_gain_velocity,
                 wp.mpc_gain_acceleration,
@@ -157,15 +370,125 @@ void oru_walk::initSolver()
                 wp.mpc_ip_mu,
                 wp.mpc_ip_bs_alpha,
                 wp.mpc_ip_bs_beta,
-                wp.mpc_ip_max_iter,
+                (level == 0) ? wp.mpc_ip_max_iter : max (1, wp.mpc_ip_max_iter >> level),
                 (smpc::backtrackingSearchType) wp.mpc_ip_bs_type,
-                false); // objective
+                false)); // objective
+    }
+    return (NULL);
+}
+
+
+
+/**
+ * @brief Get a solver from the cache, the solver is created if it is not
+ * found.
+ *
+ * @param[in] solver_type type of the solver
+ * @param[in] N the length of the preview window
+ * @param[in] level level of the solver in the ladder, see createSolver().
+ *
+ * @return a solver.
+ */
+smpc::solver * oru_walk::getSolver(const int solver_type, const int N, const int level)
+{
+    oruw_solver_key key;
+
+    key.add (solver_type);
+    key.add (N);
+    key.add (wp.mpc_gain_position);
+    key.add (wp.mpc_gain_velocity);
+    key.add (wp.mpc_gain_acceleration);
+    key.add (wp.mpc_gain_jerk);
+    if (solver_type == SOLVER_TYPE_AS)
+    {
+        key.add (wp.mpc_as_tolerance);
+        key.add ((level == 0) ? wp.mpc_as_max_activate : max (1, wp.mpc_as_max_activate >> level));
+        key.add (wp.mpc_as_use_downdate);
+    }
+    else if (solver_type == SOLVER_TYPE_IP)
+    {
+        key.add (wp.mpc_ip_tolerance_int);
+        key.add (wp.mpc_ip_tolerance_ext);
+        key.add (wp.mpc_ip_t);
+        key.add (wp.mpc_ip_mu);
+        key.add (wp.mpc_ip_bs_alpha);
+        key.add (wp.mpc_ip_bs_beta);
+        key.add ((level == 0) ? wp.mpc_ip_max_iter : max (1, wp.mpc_ip_max_iter >> level));
+        key.add (wp.mpc_ip_bs_type);
+    }
+
+
+    smpc::solver *cached_solver = solver_cache.find (key);
+    if (cached_solver == NULL)
+    {
+        cached_solver = createSolver (solver_type, N, level);
+        if (cached_solver != NULL)
+        {
+            solver_cache.add (key, cached_solver);
+        }
+    }
+    return (cached_solver);
+}
+
+
+
+/**
+ * @brief Initialize solver. In the anytime mode a ladder of solvers with
+ * decreasing limits on the number of iterations is created. The solvers
+ * are reused, if the parameters are not changed.
+ */
+void oru_walk::initSolver()
+{
+    for (int i = 0; i < ORUW_SOLVER_LADDER_SIZE; i++)
+    {
+        solver_ladder[i] = NULL;
+        solver_time_estimate[i] = 0.0;
+    }
+
+    int ladder_size = (wp.mpc_anytime || wp.effort_control) ? ORUW_SOLVER_LADDER_SIZE : 1;
+    for (int i = 0; i < ladder_size; i++)
+    {
+        solver_ladder[i] = getSolver(wp.mpc_solver_type, wp.preview_window_size, i);
     }
+    solver = solver_ladder[0];
+    mpc_truncated_num = 0;
+    initHorizon();
+    ORUW_LOG_MESSAGE("Solver cache: hits = %d // misses = %d\n", solver_cache.hits_num, solver_cache.misses_num);
 //    smpc::enable_fexceptions();
 }
 
 
 
+/**
+ * @brief Select a solver, which is expected to fit in the given time.
+ *
+ * @param[in] min_level the first level of the ladder to consider.
+ * @param[in] budget time available for solution of the MPC problem (in seconds).
+ *
+ * @return the level of the selected solver in the ladder.
+ */
+int oru_walk::selectSolver(const int min_level, const double budget)
+{
+    int level = min_level;
+    while ((level < ORUW_SOLVER_LADDER_SIZE - 1) 
+            && (solver_ladder[level + 1] != NULL)
+            && (solver_time_estimate[level] > budget))
+    {
+        ++level;
+    }
+
+    if (level > min_level)
+    {
+        ++mpc_truncated_num;
+        ORUW_LOG_MESSAGE("MPC: budget = %f // estimate = %f // solver level = %d\n",
+                budget, solver_time_estimate[min_level], level);
+    }
+    solver = solver_ladder[level];
+    return (level);
+}
+
+
+
 /**
  * @brief A control loop, that is executed in separate thread.
  * @attention REAL-TIME!
@@ -177,6 +500,19 @@ void oru_walk::walkControl()
 
     initSolver();
 
+    if (wp.walk_control_rt_mode)
+    {
+        try
+        {
+            prefaultStack();
+            prefaultWorkspaces();
+        }
+        catch (...)
+        {
+            return;
+        }
+    }
+
 
     WMG wmg(wp.preview_window_size,
             wp.preview_sampling_time_ms,
@@ -185,8 +521,16 @@ void oru_walk::walkControl()
             wp.bezier_weight_2,
             wp.bezier_inclination_1,
             wp.bezier_inclination_2);
-    wmg.T_ms[0] = wp.control_sampling_time_ms;
-    wmg.T_ms[1] = wp.control_sampling_time_ms;
+    if (wp.multi_rate)
+    {
+        wmg.T_ms[0] = wp.preview_sampling_time_ms;
+        wmg.T_ms[1] = wp.preview_sampling_time_ms;
+    }
+    else
+    {
+        wmg.T_ms[0] = wp.control_sampling_time_ms;
+        wmg.T_ms[1] = wp.control_sampling_time_ms;
+    }
 
 
     smpc::state_com CoM;
@@ -208,17 +552,97 @@ void oru_walk::walkControl()
     nao.getCoM (nao.state_sensor, nao.CoM_position);
     smpc_parameters mpc(wp.preview_window_size, nao.CoM_position[2]);
     mpc.init_state.set (nao.CoM_position[0], nao.CoM_position[1]);
+    initMPCLookup (mpc.hCoM);
 
 
+    initEffortControl();
     jointState target_joint_state = nao.state_model;
+    initMultiRate (target_joint_state);
+    // time needed to finish the loop after the MPC problem is solved
+    double ik_time_estimate = 0.0;
+    if (wp.control_pipeline)
+    {
+        try
+        {
+            startIKStage();
+        }
+        catch (...)
+        {
+            return;
+        }
+    }
+    else if (wp.ik_parallel)
+    {
+        try
+        {
+            setThreadPriority (
+                    ik_worker.start(boost::bind(&oru_walk::solveSecondIK, this)),
+                    wp.walk_control_thread_priority);
+        }
+        catch (...)
+        {
+            return;
+        }
+    }
+    startShadowSolver();
+    control_scheduler.start(
+            wp.control_sampling_time_ms, 
+            wp.control_wakeup_offset_ms, 
+            robot_io->getCycleTime());
+    startRUsage();
     for (;;)
     {
-        boost::unique_lock<boost::mutex> lock(walk_control_mutex);
-        walk_control_condition.wait(lock);
-        lock.unlock();
+        if (walk_stop_requested)
+        {
+            break;
+        }
+        if (walk_paused)
+        {
+            if (!parkControlThread())
+            {
+                break;
+            }
+            continue;
+        }
+
+        if (!waitForSensors())
+        {
+            if (walk_paused)
+            {
+                continue;
+            }
+            if (wp.control_scheduler == CONTROL_SCHEDULER_DEADLINE)
+            {
+                // the DCM is late, the period is missed; the loop is left
+                // only when walk_stop_requested is set.
+                ORUW_LOG_MESSAGE("No new sensor data, the period is skipped.\n");
+            }
+            continue;
+        }
+
+
+        if (walk_paused)
+        {
+            continue;
+        }
 
 
         timer.reset();
+        ++control_heartbeat;
+
+
+        if (wp.control_pipeline)
+        {
+            if (ik_stage_failed)
+            {
+                break;
+            }
+            if (ik_model_buffer.update())
+            {
+                nao.state_model = ik_model_buffer.getReadSlot();
+                target_joint_state = nao.state_model;
+            }
+        }
 
 
         ORUW_LOG_JOINTS(nao.state_sensor, target_joint_state);
@@ -228,22 +652,63 @@ void oru_walk::walkControl()
 
         try
         {
-            feedbackError (mpc.init_state);
+            // in the multi-rate mode the MPC problem is not solved in every loop
+            bool mpc_loop = !wp.multi_rate || (multirate_loop_index == 0);
+            smpc::state_com init_state;
+            if (mpc_loop)
+            {
+                feedbackError (mpc.init_state);
+                init_state = mpc.init_state;
+            }
 
-            if (solveMPCProblem (wmg, mpc))  // solve MPC
+            double mpc_budget = (double) wp.loop_time_limit_ms / 1000 - timer.elapsed() - ik_time_estimate;
+            if (!mpc_loop)
+            {
+                solveIKsendCommandsMultiRate (mpc, wmg);
+                target_joint_state = nao.state_model;
+            }
+            else if (solveMPCProblem (wmg, mpc, mpc_budget))  // solve MPC
             {
-                if (wmg.isSupportSwitchNeeded())
+                double mpc_done = timer.elapsed();
+
+                bool switch_support = wmg.isSupportSwitchNeeded();
+                if (switch_support)
                 {
                     correctNextSupportPosition(wmg);
                     nao.switchSupportFoot();
                 }
 
-                // the old solution from is an initial guess;
-                solver->get_state(CoM, 0);
-                solveIKsendCommands (mpc, CoM, 1, wmg);
-                target_joint_state = nao.state_model;
-                solver->get_state(CoM, 1);
-                solveIKsendCommands (mpc, CoM, 2, wmg);
+                if (wp.multi_rate)
+                {
+                    setMultiRateCoM (init_state);
+                    solveIKsendCommandsMultiRate (mpc, wmg);
+                    target_joint_state = nao.state_model;
+                }
+                else if (wp.control_pipeline)
+                {
+                    pushIKTask (mpc, wmg, switch_support);
+                }
+                else if (wp.ik_parallel)
+                {
+                    solveIKsendCommandsParallel (mpc, wmg);
+                    target_joint_state = nao.state_model;
+                    // the next IK problems are initialized with the last solution
+                    nao.state_model = nao_ik_parallel.state_model;
+                }
+                else if (wp.command_horizon > 0)
+                {
+                    solveIKsendCommandsHorizon (mpc, wmg, target_joint_state);
+                }
+                else
+                {
+                    // the old solution from is an initial guess;
+                    getMPCState (CoM, 0);
+                    solveIKsendCommands (mpc, CoM, 1, wmg);
+                    target_joint_state = nao.state_model;
+                    getMPCState (CoM, 1);
+                    solveIKsendCommands (mpc, CoM, 2, wmg);
+                }
+                ik_time_estimate = max (timer.elapsed() - mpc_done, ORUW_SOLVER_TIME_DECAY * ik_time_estimate);
             }
             else
             {
@@ -252,17 +717,63 @@ void oru_walk::walkControl()
 
             if (!timer.check()) 
             {
-                halt("Time limit is violated!\n", __FUNCTION__);
+                // in the anytime mode a late loop is tolerated, unless
+                // it does not fit in the control period.
+                if (!wp.mpc_anytime || (timer.elapsed() * 1000 > wp.control_sampling_time_ms))
+                {
+                    halt("Time limit is violated!\n", __FUNCTION__);
+                }
+            }
+
+            if (wp.effort_control)
+            {
+                adaptEffort (timer.elapsed());
             }
+            adaptHorizon (timer.elapsed());
         }
         catch (...)
         {
             break;
         }
-    }
 
+        // the first loop is not checked: it may allocate memory in the libraries
+        ORUW_ALLOC_TRACKING_CHECKPOINT;
+        ORUW_ALLOC_TRACKING_START;
+    }
+    ORUW_ALLOC_TRACKING_STOP;
+#ifdef ORUW_ALLOC_TRACKING_ENABLE
+    ORUW_LOG_MESSAGE("Memory allocations in the control loop: %d\n", ORUW_ALLOC_CHECKED_NUM);
+    // checked after the cleanup
+    const int alloc_checked_num = ORUW_ALLOC_CHECKED_NUM;
+#endif
+
+    if (wp.control_pipeline)
+    {
+        stopIKStage();
+    }
+    ik_worker.stop();
+    stopShadowSolver();
+    logMPCLookup();
+    logHorizon();
+    logRUsage();
+    if (wp.mpc_anytime)
+    {
+        ORUW_LOG_MESSAGE("Truncated MPC solutions: %d\n", mpc_truncated_num);
+        qiLogInfo ("module.oru_walk") << "Truncated MPC solutions: " << mpc_truncated_num;
+    }
+    if (wp.control_scheduler == CONTROL_SCHEDULER_DEADLINE)
+    {
+        control_scheduler.log();
+    }
     ORUW_LOG_STEPS(wmg);
     ORUW_LOG_CLOSE;
+
+#ifdef ORUW_ALLOC_TRACKING_ENABLE
+    if (alloc_checked_num != 0)
+    {
+        ORUW_THROW("Memory is allocated in the control loop.");
+    }
+#endif
 }
 
 
@@ -281,45 +792,264 @@ void oru_walk::solveIKsendCommands (
         const int control_loop_num,
         WMG &wmg)
 {
-    // hCoM is constant!
-    nao.setCoM(CoM.x(), CoM.y(), mpc.hCoM);
-
-
     // support foot and swing foot position/orientation
     wmg.getFeetPositions (
             control_loop_num * wp.control_sampling_time_ms, 
             nao.left_foot_posture.data(), 
             nao.right_foot_posture.data());
 
+    solveIK (nao, mpc.hCoM, CoM);
+    sendCommands (nao.state_model, last_dcm_time_ms + control_loop_num * wp.control_sampling_time_ms, last_dcm_time_ms);
+}
+
+
+
+/**
+ * @brief Solve the IK problems for several future samples of the MPC
+ * solution and send all joint angles in one message. The DCM executes a
+ * valid trajectory, even if the next control loop is late.
+ *
+ * @param[in] mpc MPC parameters
+ * @param[in,out] wmg WMG
+ * @param[out] target_joint_state joint angles for the next control loop
+ */
+void oru_walk::solveIKsendCommandsHorizon (
+        const smpc_parameters &mpc,
+        WMG &wmg,
+        jointState &target_joint_state)
+{
+    smpc::state_com CoM;
+    // the next control loop starts from the solution for the second sample
+    jointState next_joint_state = nao.state_model;
+    int time_ms = 0;
+    // the commands are due in the future and in ascending order
+    int earliest_time_ms = last_dcm_time_ms + wp.dcm_sampling_time_ms;
+    int first_command_time_ms = earliest_time_ms;
+
+    for (int i = 0; i < wp.command_horizon; i++)
+    {
+        time_ms += wmg.T_ms[i];
+
+        getMPCState (CoM, i);
+        wmg.getFeetPositions (
+                time_ms,
+                nao.left_foot_posture.data(),
+                nao.right_foot_posture.data());
+        solveIK (nao, mpc.hCoM, CoM);
+
+        int command_time_ms = shiftCommandTime (last_dcm_time_ms + time_ms, earliest_time_ms);
+        joint_commands_horizon.set (i, command_time_ms, nao.state_model);
+        earliest_time_ms = command_time_ms + wp.dcm_sampling_time_ms;
+        if (i == 0)
+        {
+            first_command_time_ms = command_time_ms;
+        }
+
+        if (i == 0)
+        {
+            target_joint_state = nao.state_model;
+        }
+        else if (i == 1)
+        {
+            next_joint_state = nao.state_model;
+        }
+    }
+    nao.state_model = next_joint_state;
+
+
+    if (watchdog_triggered || walk_paused)
+    {
+        return;
+    }
+
+    try
+    {
+        last_command_time_ms = first_command_time_ms;
+        robot_io->setAlias(joint_commands_horizon.commands);
+        safe_posture_buffer.getWriteSlot() = target_joint_state;
+        safe_posture_buffer.publish();
+        estimateLatency (last_command_time_ms, target_joint_state);
+    }
+    catch (const AL::ALError &e)
+    {
+        ORUW_LOG_MESSAGE("Cannot set joint angles: %s", e.what());
+        halt("Cannot set joint angles!", __FUNCTION__);
+    }
+}
+
+
+
+/**
+ * @brief Solve the IK problems for two control loops concurrently and send
+ * the commands in one message. Both problems are initialized with the same
+ * joint angles.
+ *
+ * @param[in] mpc MPC parameters
+ * @param[in,out] wmg WMG
+ */
+void oru_walk::solveIKsendCommandsParallel (
+        const smpc_parameters &mpc,
+        WMG &wmg)
+{
+    // the second problem is solved in the helper thread
+    nao_ik_parallel = nao;
+    wmg.getFeetPositions (
+            2 * wp.control_sampling_time_ms, 
+            nao_ik_parallel.left_foot_posture.data(), 
+            nao_ik_parallel.right_foot_posture.data());
+    getMPCState (ik_parallel_CoM, 1);
+    ik_parallel_hCoM = mpc.hCoM;
+    ik_worker.post();
+
+
+    smpc::state_com CoM;
+    getMPCState (CoM, 0);
+    wmg.getFeetPositions (
+            wp.control_sampling_time_ms, 
+            nao.left_foot_posture.data(), 
+            nao.right_foot_posture.data());
+    solveIK (nao, mpc.hCoM, CoM);
+
+
+    ik_worker.wait();
+    if (ik_worker.failed)
+    {
+        halt("The second IK problem is not solved.\n", __FUNCTION__);
+    }
+
+    sendCommands (
+            nao.state_model, 
+            nao_ik_parallel.state_model, 
+            last_dcm_time_ms + wp.control_sampling_time_ms,
+            wp.control_sampling_time_ms);
+}
+
+
+
+/**
+ * @brief The job of the helper thread: solve the IK problem for the
+ * second control loop.
+ */
+void oru_walk::solveSecondIK ()
+{
+    solveIK (nao_ik_parallel, ik_parallel_hCoM, ik_parallel_CoM);
+}
+
+
+
+/**
+ * @brief Solve inverse kinematics, the positions of the feet must be set 
+ * in advance.
+ *
+ * @param[in,out] igm_model the model of the robot
+ * @param[in] hCoM height of the CoM
+ * @param[in] CoM  CoM position
+ */
+void oru_walk::solveIK (
+        nao_igm &igm_model,
+        const double hCoM,
+        const smpc::state_com &CoM)
+{
+    // hCoM is constant!
+    igm_model.setCoM(CoM.x(), CoM.y(), hCoM);
+
 
     // inverse kinematics
-    int iter_num = nao.igm (
+    int iter_num = igm_model.igm (
             ref_joint_angles, 
             wp.igm_mu, 
             wp.igm_tol, 
-            wp.igm_max_iter);
+            igm_max_iter);
     ORUW_LOG_MESSAGE("IGM iterations num: %d\n", iter_num);
     if (iter_num < 0)
     {
-        halt("IK does not converge.\n", __FUNCTION__);
+        // the limit may be reduced by the effort controller, in this case
+        // the approximate solution is used.
+        if (igm_max_iter >= wp.igm_max_iter)
+        {
+            halt("IK does not converge.\n", __FUNCTION__);
+        }
+        ORUW_LOG_MESSAGE("IK is truncated.\n");
     }
-    int failed_joint = nao.state_model.checkJointBounds();
+    int failed_joint = igm_model.state_model.checkJointBounds();
     if (failed_joint >= 0)
     {
         ORUW_LOG_MESSAGE("Failed joint: %d\n", failed_joint);
         halt("Joint bounds are violated.\n", __FUNCTION__);
     }
+}
+
+
 
+/**
+ * @brief Send joint angles to the controllers.
+ *
+ * @param[in] joint_state target joint angles
+ * @param[in] dcm_time_ms the DCM time, when the angles must be reached
+ * @param[in] sensor_time_ms the DCM time of the sensor data, which was
+ * used to compute the angles
+ */
+void oru_walk::sendCommands (
+        const jointState &joint_state,
+        const int dcm_time_ms,
+        const int sensor_time_ms)
+{
+    if (watchdog_triggered || walk_paused)
+    {
+        return;
+    }
 
-    // Set commands
     try
     {
-        joint_commands[4][0] = last_dcm_time_ms + control_loop_num * wp.control_sampling_time_ms;
-        for (int i = 0; i < LOWER_JOINTS_NUM; i++)
-        {
-            joint_commands[5][i][0] = nao.state_model.q[i];
-        }
-        dcm_proxy->setAlias(joint_commands);
+        int command_time_ms = shiftCommandTime (dcm_time_ms, sensor_time_ms + wp.dcm_sampling_time_ms);
+        joint_commands.set (0, command_time_ms, joint_state);
+        last_command_time_ms = command_time_ms;
+        robot_io->setAlias(joint_commands.commands);
+        safe_posture_buffer.getWriteSlot() = joint_state;
+        safe_posture_buffer.publish();
+        estimateLatency (last_command_time_ms, joint_state);
+    }
+    catch (const AL::ALError &e)
+    {
+        ORUW_LOG_MESSAGE("Cannot set joint angles: %s", e.what());
+        halt("Cannot set joint angles!", __FUNCTION__);
+    }
+}
+
+
+
+/**
+ * @brief Send two consecutive sets of joint angles in one message.
+ *
+ * @param[in] joint_state_1 the first target joint angles
+ * @param[in] joint_state_2 the second target joint angles
+ * @param[in] dcm_time_ms the DCM time, when the first angles must be reached
+ * @param[in] interval_ms time between the first and the second angles
+ */
+void oru_walk::sendCommands (
+        const jointState &joint_state_1,
+        const jointState &joint_state_2,
+        const int dcm_time_ms,
+        const int interval_ms)
+{
+    if (watchdog_triggered || walk_paused)
+    {
+        return;
+    }
+
+    try
+    {
+        // called only by the control thread
+        int command_time_ms = shiftCommandTime (dcm_time_ms, last_dcm_time_ms + wp.dcm_sampling_time_ms);
+        joint_commands_pair.set (0, command_time_ms, joint_state_1);
+        joint_commands_pair.set (1,
+                shiftCommandTime (dcm_time_ms + interval_ms, command_time_ms + wp.dcm_sampling_time_ms),
+                joint_state_2);
+        last_command_time_ms = command_time_ms;
+        robot_io->setAlias(joint_commands_pair.commands);
+        safe_posture_buffer.getWriteSlot() = joint_state_1;
+        safe_posture_buffer.publish();
+        estimateLatency (last_command_time_ms, joint_state_1);
     }
     catch (const AL::ALError &e)
     {
@@ -333,11 +1063,26 @@ void oru_walk::solveIKsendCommands (
 /**
  * @brief Correct state and the model based on the sensor data.
  *
+ * By default (feedback_delay_ms = 0) the latest sensor data is used, as
+ * before the history was introduced. Otherwise the data is taken from the
+ * history at the time, when the last commands were due, shifted by the
+ * delay of the sensors; the latest data is used, if this time is older
+ * than the history.
+ *
  * @param[in,out] init_state expected state
  */
 void oru_walk::feedbackError (smpc::state_com &init_state)
 {
-    nao.getCoM (nao.state_sensor, nao.CoM_position);
+    if ((wp.feedback_delay_ms > 0)
+            && sensor_history.getSnapshot (last_command_time_ms + wp.feedback_delay_ms, feedback_sensors))
+    {
+        feedback_sensors.getJointState (feedback_joint_state);
+    }
+    else
+    {
+        feedback_joint_state = nao.state_sensor;
+    }
+    nao.getCoM (feedback_joint_state, nao.CoM_position);
 
 
     smpc::state_com state_error;
@@ -382,12 +1127,15 @@ void oru_walk::feedbackError (smpc::state_com &init_state)
  *
  * @param[in,out] wmg WMG
  * @param[in,out] mpc MPC parameters
+ * @param[in] budget time available for this function (in seconds), used
+ * only in the anytime mode.
  *
  * @return false if there is not enough steps, true otherwise.
  */
 bool oru_walk::solveMPCProblem (
         WMG &wmg,
-        smpc_parameters &mpc)
+        smpc_parameters &mpc,
+        const double budget)
 {
     oruw_timer timer(__FUNCTION__, wp.loop_time_limit_ms);
 
@@ -397,6 +1145,25 @@ bool oru_walk::solveMPCProblem (
         return (false);
     }
 
+    if (lookupMPCSolution (mpc))
+    {
+        return (true);
+    }
+
+    // 0 unless the effort controller is enabled
+    int level = effort_level;
+    if (wp.mpc_anytime)
+    {
+        level = selectSolver(level, budget - timer.elapsed());
+    }
+    else
+    {
+        solver = solver_ladder[level];
+    }
+    selectHorizon();
+    bool shadow = prepareShadowProblem (mpc);
+    double solve_start = timer.elapsed();
+
     //------------------------------------------------------
     solver->set_parameters (mpc.T, mpc.h, mpc.h[0], mpc.angle, mpc.zref_x, mpc.zref_y, mpc.lb, mpc.ub);
     solver->form_init_fp (mpc.fp_x, mpc.fp_y, mpc.init_state, mpc.X);
@@ -404,11 +1171,28 @@ bool oru_walk::solveMPCProblem (
     solver->get_next_state(mpc.init_state);
     //------------------------------------------------------
 
+    double solve_time = timer.elapsed() - solve_start;
+    // the estimates are obtained for the full preview window
+    if (wp.mpc_anytime && (horizon_level == 0))
+    {
+        solver_time_estimate[level] = max (
+                solve_time,
+                ORUW_SOLVER_TIME_DECAY * solver_time_estimate[level]);
+    }
+    if (shadow)
+    {
+        postShadowProblem (mpc.init_state, solve_time);
+    }
+
 
     ORUW_LOG_SOLVER_INFO;
     if (!timer.check()) 
     {
-        halt("Time limit is violated!\n", __FUNCTION__);
+        // checked in walkControl() in the anytime mode
+        if (!wp.mpc_anytime)
+        {
+            halt("Time limit is violated!\n", __FUNCTION__);
+        }
     }
 
     return (true);
@@ -419,21 +1203,54 @@ bool oru_walk::solveMPCProblem (
 
 
 /**
- * @brief Unregister callback and log a message.
+ * @brief Request the control loop to stop, unregister callback and log a
+ * message. The watchdog is not stopped, hence this function may be called
+ * by the watchdog itself.
  *
  * @param[in] message a message
  */
-void oru_walk::stopWalking(const char* message)
+void oru_walk::requestStop(const char* message)
 {
+    walk_stop_requested = true;
+    __sync_synchronize();
+
     ORUW_LOG_MESSAGE("%s", message);
     qiLogInfo ("module.oru_walk") << message;
-    dcm_callback_connection.disconnect();
+    robot_io->disconnectCallback();
+
+    // wake up the control thread, if it waits for the DCM callback
+    sem_post (&walk_control_sem);
+}
+
+
+
+/**
+ * @brief Unregister callback, stop the watchdog and log a message.
+ *
+ * @param[in] message a message
+ */
+void oru_walk::stopWalking(const char* message)
+{
+    requestStop (message);
+
+    // resumeWalking() does not connect the callback after the stop is
+    // requested, pauseWalking() returns, when it sees the request.
+    boost::mutex::scoped_lock lock(pause_mutex);
+    if (walk_paused)
+    {
+        // the control thread is parked
+        walk_paused = false;
+        sem_post (&walk_resume_sem);
+    }
+    // may be connected by resumeWalking() before the lock was acquired
+    robot_io->disconnectCallback();
+    stopWatchdog();
 }
 
 
 
 /**
- * @brief Log a message, remove stiffness and die.
+ * @brief Log a message, start removing stiffness and die.
  *
  * @param[in] message a message
  * @param[in] function name of the calling function.
@@ -441,7 +1258,7 @@ void oru_walk::stopWalking(const char* message)
 void oru_walk::halt(const char *message, const char* function)
 {
     stopWalking(message);
-    setStiffness(0.0);
+    setStiffnessAsync(0.0);
     throw ALERROR(getName(), function, message);
 }
 
@@ -0,0 +1,102 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief Compare the cost of updating the commands for the DCM by indexing
+ * of the nested ALValue arrays and through the cached addresses of the
+ * values (walkCommands). The commands are also copied to estimate the
+ * cost of their serialization, which is the same in both cases, and are
+ * submitted through robotIO::setAlias() of the simulated DCM
+ * (robotIOSim), i.e. the path used by the module without the DCM of
+ * NAOqi.
+ *
+ * The DCM of NAOqi is not measured: this program would reach it through a
+ * remote proxy, which is not the local call made by the module, and the
+ * commands would move the robot.
+ *
+ * Requires NAOqi SDK, is built with the module if ORUW_BENCHMARKS is set.
+ */
+
+#include <cstdio>
+#include <ctime>
+
+#include "walk_commands.h"
+#include "robot_io_sim.h"
+
+
+#define BENCH_ITERATIONS 100000
+
+
+double getTimeMs()
+{
+    timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return ((double) now.tv_sec * 1000 + (double) now.tv_nsec / 1000000);
+}
+
+
+int main(int argc, char **argv)
+{
+    jointState joint_state;
+    for (int i = 0; i < JOINTS_NUM; i++)
+    {
+        joint_state.q[i] = 0.01 * i;
+    }
+
+    walkCommands commands;
+    commands.init("lowerJointActuator", 1);
+
+
+    // nested indexing
+    double start = getTimeMs();
+    for (int k = 0; k < BENCH_ITERATIONS; k++)
+    {
+        commands.commands[4][0] = k;
+        for (int i = 0; i < LOWER_JOINTS_NUM; i++)
+        {
+            commands.commands[5][i][0] = (float) joint_state.q[i];
+        }
+    }
+    double nested_ms = getTimeMs() - start;
+
+
+    // cached addresses
+    start = getTimeMs();
+    for (int k = 0; k < BENCH_ITERATIONS; k++)
+    {
+        commands.set(0, k, joint_state);
+    }
+    double cached_ms = getTimeMs() - start;
+
+
+    // copy of the whole structure
+    int copied_size = 0;
+    start = getTimeMs();
+    for (int k = 0; k < BENCH_ITERATIONS; k++)
+    {
+        ALValue copy = commands.commands;
+        copied_size += copy.getSize();
+    }
+    double copy_ms = getTimeMs() - start;
+
+
+    // submission: update and setAlias() of the simulated DCM, the DCM
+    // thread runs concurrently
+    robotIOSim robot_io (10, 10);
+    start = getTimeMs();
+    for (int k = 0; k < BENCH_ITERATIONS; k++)
+    {
+        commands.set(0, robot_io.getTime(20), joint_state);
+        robot_io.setAlias(commands.commands);
+    }
+    double submit_ms = getTimeMs() - start;
+
+
+    printf("Update of one command (us): nested ALValue = %f // cached slots = %f\n",
+            nested_ms * 1000 / BENCH_ITERATIONS,
+            cached_ms * 1000 / BENCH_ITERATIONS);
+    printf("Copy of one command (us): %f (%d)\n", copy_ms * 1000 / BENCH_ITERATIONS, copied_size);
+    printf("Submission of one command to the simulated DCM (us): %f\n", submit_ms * 1000 / BENCH_ITERATIONS);
+
+    return (0);
+}
@@ -0,0 +1,555 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief Build the table of explicit MPC control laws for the straight
+ * walk (WALK_PATTERN_STRAIGHT) with the default parameters of the module.
+ * The walk is simulated, for each new preview window an affine control law
+ * is obtained by central differences around the nominal initial state and
+ * checked in the corners of a box, the box is shrunk until the error is
+ * within the tolerance.
+ *
+ * Usage: empc_table [output file [hCoM]], the default output file is
+ * oru_empc.table, it must be copied to the working directory of NAOqi.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib> // atof
+#include <limits>
+#include <cmath> // abs, M_PI
+#include <cstring> //strcmp
+
+
+#include "WMG.h"
+#include "smpc_solver.h"
+#include "nao_igm.h"
+#include "joints_sensors_id.h"
+
+#include "oruw_empc_table.h"
+
+
+using namespace std;
+
+
+#include "init_steps_nao.cpp"
+
+
+/// step of the central differences
+#define EMPC_DIFF_STEP 1e-5
+/// the maximal error of the law in the box
+#define EMPC_TOLERANCE 1e-4
+/// the number of times the box is halved
+#define EMPC_SHRINK_NUM 4
+
+
+
+/**
+ * @brief Solve the problem and get the first states of the solution.
+ */
+void solve (
+        smpc::solver_as &solver,
+        smpc_parameters &par,
+        const smpc::state_com &init_state,
+        smpc::state_com *states)
+{
+    solver.set_parameters (par.T, par.h, par.h[0], par.angle, par.zref_x, par.zref_y, par.lb, par.ub);
+    solver.form_init_fp (par.fp_x, par.fp_y, init_state, par.X);
+    solver.solve();
+    for (int k = 0; k < ORUW_EMPC_STATES_NUM; k++)
+    {
+        solver.get_state(states[k], k);
+    }
+}
+
+
+
+/**
+ * @brief Copy the problem and move the steps as the correction of the
+ * position of the next support foot does: the reference ZMP points are
+ * fixed in the frames of the feet.
+ *
+ * @param[in] par the nominal problem
+ * @param[in] problem the decomposition of the nominal problem
+ * @param[in] param_diff changes of the parameters of the steps
+ * @param[in] N the length of the preview window
+ * @param[out] moved the changed problem
+ */
+void moveSteps (
+        const smpc_parameters &par,
+        const oruw_empc_problem &problem,
+        const double *param_diff,
+        const int N,
+        smpc_parameters &moved)
+{
+    for (int i = 0; i < N; i++)
+    {
+        moved.T[i] = par.T[i];
+        moved.h[i] = par.h[i];
+        moved.angle[i] = par.angle[i];
+        moved.zref_x[i] = par.zref_x[i];
+        moved.zref_y[i] = par.zref_y[i];
+        moved.fp_x[i] = par.fp_x[i];
+        moved.fp_y[i] = par.fp_y[i];
+    }
+    for (int i = 0; i < 2*N; i++)
+    {
+        moved.lb[i] = par.lb[i];
+        moved.ub[i] = par.ub[i];
+    }
+
+    int i = 0;
+    for (int step = 0; step < problem.steps_num; step++)
+    {
+        const double dx = param_diff[step * ORUW_EMPC_STEP_SIZE];
+        const double dy = param_diff[step * ORUW_EMPC_STEP_SIZE + 1];
+        const double da = param_diff[step * ORUW_EMPC_STEP_SIZE + 2];
+
+        for (; i < problem.step_end[step]; i++)
+        {
+            const double ref_x = par.zref_x[i] - par.fp_x[i];
+            const double ref_y = par.zref_y[i] - par.fp_y[i];
+
+            moved.fp_x[i] = par.fp_x[i] + dx;
+            moved.fp_y[i] = par.fp_y[i] + dy;
+            moved.angle[i] = par.angle[i] + da;
+            moved.zref_x[i] = moved.fp_x[i] + cos(da) * ref_x - sin(da) * ref_y;
+            moved.zref_y[i] = moved.fp_y[i] + sin(da) * ref_x + cos(da) * ref_y;
+        }
+    }
+}
+
+
+
+/**
+ * @brief Compare the law with the solver at the given point.
+ *
+ * @return the maximal error.
+ */
+double checkPoint (
+        smpc::solver_as &solver,
+        const smpc_parameters &par,
+        const oruw_empc_problem &problem,
+        const oruw_empc_law &law,
+        const double *state_diff,
+        const double *param_diff,
+        smpc_parameters &moved)
+{
+    const int N = problem.step_end[problem.steps_num - 1];
+
+    smpc::state_com init_state;
+    for (int i = 0; i < ORUW_EMPC_STATE_SIZE; i++)
+    {
+        init_state.state_vector[i] = law.init_state[i] + state_diff[i];
+    }
+    init_state.state_vector[0] += problem.origin_x;
+    init_state.state_vector[3] += problem.origin_y;
+
+    moveSteps (par, problem, param_diff, N, moved);
+    oruw_empc_problem moved_problem;
+    moved_problem.set (moved, N);
+
+    smpc::state_com states[ORUW_EMPC_STATES_NUM];
+    smpc::state_com law_states[ORUW_EMPC_STATES_NUM];
+    solve (solver, moved, init_state, states);
+    if (!oruw_empc_table::evaluate (law, moved_problem, init_state, law_states))
+    {
+        return (numeric_limits<double>::infinity());
+    }
+
+    double max_error = 0.0;
+    for (int k = 0; k < ORUW_EMPC_STATES_NUM; k++)
+    {
+        for (int i = 0; i < ORUW_EMPC_STATE_SIZE; i++)
+        {
+            max_error = max (max_error,
+                    fabs (states[k].state_vector[i] - law_states[k].state_vector[i]));
+        }
+    }
+    return (max_error);
+}
+
+
+
+/**
+ * @brief Check the law in the corners of the box of the initial state,
+ * along the axes of the parameters and in two opposite corners of the
+ * whole box. The check is not exhaustive, the module also checks the
+ * bounds for each evaluated solution (oruw_empc_table::checkBounds()).
+ *
+ * @return the maximal error.
+ */
+double checkLaw (
+        smpc::solver_as &solver,
+        const smpc_parameters &par,
+        const oruw_empc_problem &problem,
+        const oruw_empc_law &law,
+        smpc_parameters &moved)
+{
+    double state_diff[ORUW_EMPC_STATE_SIZE];
+    double param_diff[ORUW_EMPC_PARAMS_NUM];
+    double max_error = 0.0;
+
+
+    for (int j = 0; j < ORUW_EMPC_PARAMS_NUM; j++)
+    {
+        param_diff[j] = 0.0;
+    }
+    for (int corner = 0; corner < (1 << ORUW_EMPC_STATE_SIZE); corner++)
+    {
+        for (int i = 0; i < ORUW_EMPC_STATE_SIZE; i++)
+        {
+            state_diff[i] = ((corner >> i) & 1) ? law.state_range[i] : -law.state_range[i];
+        }
+        max_error = max (max_error, checkPoint (solver, par, problem, law, state_diff, param_diff, moved));
+    }
+
+
+    for (int i = 0; i < ORUW_EMPC_STATE_SIZE; i++)
+    {
+        state_diff[i] = 0.0;
+    }
+    for (int j = 0; j < problem.steps_num * ORUW_EMPC_STEP_SIZE; j++)
+    {
+        for (int sign = -1; sign <= 1; sign += 2)
+        {
+            param_diff[j] = sign * law.param_range[j];
+            max_error = max (max_error, checkPoint (solver, par, problem, law, state_diff, param_diff, moved));
+        }
+        param_diff[j] = 0.0;
+    }
+
+
+    for (int sign = -1; sign <= 1; sign += 2)
+    {
+        for (int i = 0; i < ORUW_EMPC_STATE_SIZE; i++)
+        {
+            state_diff[i] = sign * law.state_range[i];
+        }
+        for (int j = 0; j < ORUW_EMPC_PARAMS_NUM; j++)
+        {
+            param_diff[j] = sign * law.param_range[j];
+        }
+        max_error = max (max_error, checkPoint (solver, par, problem, law, state_diff, param_diff, moved));
+    }
+
+    return (max_error);
+}
+
+
+
+/**
+ * @brief Build a law for the current preview window.
+ *
+ * @return false if the law is not accurate in the smallest box.
+ */
+bool buildLaw (
+        smpc::solver_as &solver,
+        const smpc_parameters &par,
+        const oruw_empc_problem &problem,
+        oruw_empc_law &law,
+        smpc_parameters &moved)
+{
+    const int N = problem.step_end[problem.steps_num - 1];
+
+    // half-widths of the initial box: positions, velocities, accelerations
+    const double state_range[ORUW_EMPC_STATE_SIZE] = {0.005, 0.02, 0.2, 0.005, 0.02, 0.2};
+    // position and orientation of a step
+    const double step_range[ORUW_EMPC_STEP_SIZE] = {0.01, 0.01, 0.05};
+
+    smpc::state_com nominal_states[ORUW_EMPC_STATES_NUM];
+    smpc::state_com states_plus[ORUW_EMPC_STATES_NUM];
+    smpc::state_com states_minus[ORUW_EMPC_STATES_NUM];
+
+    double param_diff[ORUW_EMPC_PARAMS_NUM];
+    for (int j = 0; j < ORUW_EMPC_PARAMS_NUM; j++)
+    {
+        param_diff[j] = 0.0;
+    }
+
+    law.hash = problem.hash;
+    for (int i = 0; i < ORUW_EMPC_KEY_SIZE; i++)
+    {
+        law.key[i] = problem.key[i];
+    }
+    moveSteps (par, problem, param_diff, N, moved);
+    solve (solver, moved, par.init_state, nominal_states);
+    for (int i = 0; i < ORUW_EMPC_STATE_SIZE; i++)
+    {
+        law.init_state[i] = par.init_state.state_vector[i];
+        for (int k = 0; k < ORUW_EMPC_STATES_NUM; k++)
+        {
+            law.state[k][i] = nominal_states[k].state_vector[i];
+        }
+    }
+    law.init_state[0] -= problem.origin_x;
+    law.init_state[3] -= problem.origin_y;
+    for (int k = 0; k < ORUW_EMPC_STATES_NUM; k++)
+    {
+        law.state[k][0] -= problem.origin_x;
+        law.state[k][3] -= problem.origin_y;
+    }
+    for (int j = 0; j < ORUW_EMPC_PARAMS_NUM; j++)
+    {
+        law.params[j] = problem.params[j];
+    }
+
+
+    // gains of the initial state
+    for (int j = 0; j < ORUW_EMPC_STATE_SIZE; j++)
+    {
+        smpc::state_com init_state = par.init_state;
+
+        init_state.state_vector[j] = par.init_state.state_vector[j] + EMPC_DIFF_STEP;
+        solve (solver, moved, init_state, states_plus);
+        init_state.state_vector[j] = par.init_state.state_vector[j] - EMPC_DIFF_STEP;
+        solve (solver, moved, init_state, states_minus);
+
+        for (int k = 0; k < ORUW_EMPC_STATES_NUM; k++)
+        {
+            for (int i = 0; i < ORUW_EMPC_STATE_SIZE; i++)
+            {
+                law.state_gain[k][i][j] =
+                    (states_plus[k].state_vector[i] - states_minus[k].state_vector[i])
+                    / (2 * EMPC_DIFF_STEP);
+            }
+        }
+    }
+
+
+    // gains of the parameters of the steps
+    for (int j = 0; j < ORUW_EMPC_PARAMS_NUM; j++)
+    {
+        if (j >= problem.steps_num * ORUW_EMPC_STEP_SIZE)
+        {
+            for (int k = 0; k < ORUW_EMPC_STATES_NUM; k++)
+            {
+                for (int i = 0; i < ORUW_EMPC_STATE_SIZE; i++)
+                {
+                    law.param_gain[k][i][j] = 0.0;
+                }
+            }
+            continue;
+        }
+
+        param_diff[j] = EMPC_DIFF_STEP;
+        moveSteps (par, problem, param_diff, N, moved);
+        solve (solver, moved, par.init_state, states_plus);
+        param_diff[j] = -EMPC_DIFF_STEP;
+        moveSteps (par, problem, param_diff, N, moved);
+        solve (solver, moved, par.init_state, states_minus);
+        param_diff[j] = 0.0;
+
+        for (int k = 0; k < ORUW_EMPC_STATES_NUM; k++)
+        {
+            for (int i = 0; i < ORUW_EMPC_STATE_SIZE; i++)
+            {
+                law.param_gain[k][i][j] =
+                    (states_plus[k].state_vector[i] - states_minus[k].state_vector[i])
+                    / (2 * EMPC_DIFF_STEP);
+            }
+        }
+    }
+
+
+    double scale = 1.0;
+    for (int attempt = 0; attempt <= EMPC_SHRINK_NUM; attempt++, scale /= 2)
+    {
+        for (int i = 0; i < ORUW_EMPC_STATE_SIZE; i++)
+        {
+            law.state_range[i] = state_range[i] * scale;
+        }
+        for (int j = 0; j < ORUW_EMPC_PARAMS_NUM; j++)
+        {
+            law.param_range[j] = (j < problem.steps_num * ORUW_EMPC_STEP_SIZE)
+                ? step_range[j % ORUW_EMPC_STEP_SIZE] * scale
+                : 0.0;
+        }
+        if (checkLaw (solver, par, problem, law, moved) <= EMPC_TOLERANCE)
+        {
+            return (true);
+        }
+    }
+    return (false);
+}
+
+
+
+int main(int argc, char **argv)
+{
+    const char *filename = (argc > 1) ? argv[1] : "oru_empc.table";
+
+    //-----------------------------------------------------------
+    // the default parameters of the module
+    int control_sampling_time_ms = 20;
+    int preview_sampling_time_ms = 40;
+    int preview_window_size = 40;
+    double gain_position = 8000.0;
+    double gain_velocity = 1.0;
+    double gain_acceleration = 0.02;
+    double gain_jerk = 1.0;
+
+    int ss_time_ms = 400;
+    int ds_time_ms = 40;
+    int ds_number = 3;
+    int step_pairs_number = 4;
+    double step_x = 0.04;
+    //-----------------------------------------------------------
+
+
+    //-----------------------------------------------------------
+    // the initial posture of the module
+    nao_igm nao;
+    double ref_angles[LOWER_JOINTS_NUM];
+    initNaoModel (nao, ref_angles);
+    nao.init (
+            IGM_SUPPORT_LEFT,
+            0.0, 0.05, 0.0,
+            0.0, 0.0, 0.0);
+    nao.getCoM(nao.state_sensor, nao.CoM_position);
+    if (argc > 2)
+    {
+        nao.CoM_position[2] = atof (argv[2]);
+    }
+    //-----------------------------------------------------------
+
+
+    //-----------------------------------------------------------
+    // see oru_walk::initWalkPattern_Straight()
+    WMG wmg (preview_window_size, preview_sampling_time_ms, 0.02);
+    smpc_parameters par (wmg.N, nao.CoM_position[2]);
+    par.init_state.set (nao.CoM_position[0], nao.CoM_position[1]);
+
+    double step_y = wmg.def_constraints.support_distance_y;
+
+    wmg.setFootstepParametersMS(0, 0, 0);
+    wmg.addFootstep(0.0, step_y/2, 0.0, FS_TYPE_SS_L);
+
+    wmg.setFootstepParametersMS(3*ss_time_ms, 0, 0);
+    wmg.addFootstep(0.0, -step_y/2, 0.0, FS_TYPE_DS);
+
+    wmg.setFootstepParametersMS(ss_time_ms, 0, 0);
+    wmg.addFootstep(0.0   , -step_y/2, 0.0);
+    wmg.setFootstepParametersMS(ss_time_ms, ds_time_ms, ds_number);
+    wmg.addFootstep(step_x,  step_y,   0.0);
+
+    for (int i = 0; i < step_pairs_number; i++)
+    {
+        wmg.addFootstep(step_x, -step_y, 0.0);
+        wmg.addFootstep(step_x,  step_y, 0.0);
+    }
+
+    wmg.setFootstepParametersMS(5*ss_time_ms, 0, 0);
+    wmg.addFootstep(0.0   , -step_y/2, 0.0, FS_TYPE_DS);
+    wmg.setFootstepParametersMS(0, 0, 0);
+    wmg.addFootstep(0.0   , -step_y/2, 0.0, FS_TYPE_SS_R);
+
+    wmg.T_ms[0] = control_sampling_time_ms;
+    wmg.T_ms[1] = control_sampling_time_ms;
+    //-----------------------------------------------------------
+
+
+    // the number of activated constraints is not limited
+    smpc::solver_as solver(
+            wmg.N,
+            gain_position,
+            gain_velocity,
+            gain_acceleration,
+            gain_jerk,
+            1e-7,           // tolerance
+            4 * wmg.N,      // limit on the number of activated constraints
+            true,           // enable constraint removal
+            false);         // obj
+
+
+    oruw_empc_table table;
+    table.header.preview_window_size = preview_window_size;
+    table.header.hCoM = par.hCoM;
+    table.header.gain_position = gain_position;
+    table.header.gain_velocity = gain_velocity;
+    table.header.gain_acceleration = gain_acceleration;
+    table.header.gain_jerk = gain_jerk;
+
+
+    smpc_parameters moved (wmg.N, par.hCoM);
+    oruw_empc_problem problem;
+    smpc::state_com states[ORUW_EMPC_STATES_NUM];
+
+    int ticks_num = 0;
+    int repeated_num = 0;
+    int failed_num = 0;
+    for (;; ++ticks_num)
+    {
+        if (wmg.formPreviewWindow(par) == WMG_HALT)
+        {
+            break;
+        }
+
+        if (!problem.set (par, wmg.N))
+        {
+            ++failed_num;
+            printf("(%3i)  too many steps in the preview window.\n", ticks_num);
+        }
+        else
+        {
+            const oruw_empc_law *known_law = NULL;
+            for (unsigned int i = 0; i < table.laws.size(); i++)
+            {
+                if (table.laws[i].matches (problem))
+                {
+                    known_law = &table.laws[i];
+                    break;
+                }
+            }
+
+            if (known_law != NULL)
+            {
+                ++repeated_num;
+                if (!oruw_empc_table::evaluate (*known_law, problem, par.init_state, states))
+                {
+                    printf("(%3i)  the problem is outside of the box of the law built for the same structure.\n", ticks_num);
+                }
+                else if (!oruw_empc_table::checkBounds (par, states))
+                {
+                    printf("(%3i)  the law violates the bounds, the problem is left for the online solver.\n", ticks_num);
+                }
+            }
+            else
+            {
+                oruw_empc_law law;
+                if (buildLaw (solver, par, problem, law, moved))
+                {
+                    table.laws.push_back(law);
+                }
+                else
+                {
+                    ++failed_num;
+                    printf("(%3i)  the law is not accurate, the problem is left for the online solver.\n", ticks_num);
+                }
+            }
+        }
+
+        // the nominal trajectory
+        solve (solver, par, par.init_state, states);
+        solver.get_next_state(par.init_state);
+    }
+
+
+    if (!table.save (filename))
+    {
+        printf("Cannot write '%s'.\n", filename);
+        return (1);
+    }
+
+    printf("%s: hCoM = %f // ticks = %d // laws = %d // repeated = %d // failed = %d // size = %d bytes\n",
+            filename,
+            table.header.hCoM,
+            ticks_num,
+            (int) table.laws.size(),
+            repeated_num,
+            failed_num,
+            (int) (sizeof(oruw_empc_header) + table.laws.size() * sizeof(oruw_empc_law)));
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief Check, that the calls of the libraries (WMG, solver, IK), which
+ * are made in each control loop, do not allocate memory: the allocation
+ * functions are interposed and the allocations are counted between the
+ * first and the last iterations of a walk.
+ *
+ * @attention This test does not cover the control loop of the module
+ * (oru_walk::walkControl()), which requires NAOqi. The loop is checked by
+ * walk_alloc.cpp.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <limits>
+#include <cmath> // abs, M_PI
+#include <cstring> //strcmp
+
+
+#define ORUW_ALLOC_TRACKING_ENABLE
+
+#include "WMG.h"
+#include "smpc_solver.h"
+#include "nao_igm.h"
+#include "joints_sensors_id.h"
+
+#include "../src/oruw_alloc.cpp"
+
+
+using namespace std;
+
+
+#include "init_steps_nao.cpp"
+
+
+bool ik(init_11 &tdata, const smpc::state_com &CoM, int time)
+{
+    tdata.wmg->getFeetPositions (
+            time,
+            tdata.nao.left_foot_posture.data(),
+            tdata.nao.right_foot_posture.data());
+
+    // position of CoM
+    tdata.nao.setCoM(CoM.x(), CoM.y(), tdata.par->hCoM);
+
+    if (tdata.nao.igm(tdata.ref_angles, 1.0, 0.0015, 20) < 0)
+    {
+        return (false);
+    }
+    return (tdata.nao.state_model.checkJointBounds() < 0);
+}
+
+
+int main(int argc, char **argv)
+{
+    //-----------------------------------------------------------
+    // sampling
+    int control_sampling_time_ms = 20;
+    int preview_sampling_time_ms = 40;
+    //-----------------------------------------------------------
+
+
+
+    //-----------------------------------------------------------
+    // initialize classes
+    init_11 test("test_11", preview_sampling_time_ms, false);
+
+    smpc::solver_as solver(
+            test.wmg->N,    // size of the preview window
+            8000.0,         // gain_position
+            1.0,            // gain_velocity
+            0.02,           // gain_acceleration
+            1.0,            // gain_jerk
+            1e-7,           // tolerance
+            20,             // limit on the number of activated constraints
+            true,           // enable constraint removal
+            false);         // obj
+    //-----------------------------------------------------------
+
+
+
+    //-----------------------------------------------------------
+    test.nao.getCoM(test.nao.state_sensor, test.nao.CoM_position);
+    test.par->init_state.set (test.nao.CoM_position[0], test.nao.CoM_position[1]);
+    //-----------------------------------------------------------
+
+
+    test.wmg->T_ms[0] = control_sampling_time_ms;
+    test.wmg->T_ms[1] = control_sampling_time_ms;
+    smpc::state_com CoM;
+    int counter;
+    for(counter = 0 ;; ++counter)
+    {
+// solve MPC
+        if (test.wmg->formPreviewWindow(*test.par) == WMG_HALT)
+        {
+            break;
+        }
+        if (test.wmg->isSupportSwitchNeeded())
+        {
+            test.nao.switchSupportFoot();
+        }
+
+        solver.set_parameters (test.par->T, test.par->h, test.par->h[0], test.par->angle, test.par->zref_x, test.par->zref_y, test.par->lb, test.par->ub);
+        solver.form_init_fp (test.par->fp_x, test.par->fp_y, test.par->init_state, test.par->X);
+        solver.solve();
+        solver.get_next_state(test.par->init_state);
+
+
+// solve IK
+        solver.get_state(CoM, 0);
+        if (!ik(test, CoM, control_sampling_time_ms))
+        {
+            printf("(%3i) IK failed!\n", counter);
+        }
+        solver.get_state(CoM, 1);
+        if (!ik(test, CoM, 2*control_sampling_time_ms))
+        {
+            printf("(%3i) IK failed!\n", counter);
+        }
+
+
+        // the first iteration is not checked
+        ORUW_ALLOC_TRACKING_CHECKPOINT;
+        ORUW_ALLOC_TRACKING_START;
+    }
+    ORUW_ALLOC_TRACKING_STOP;
+
+
+    printf("Iterations: %d // allocations: %d\n", counter, ORUW_ALLOC_CHECKED_NUM);
+    if (ORUW_ALLOC_CHECKED_NUM != 0)
+    {
+        printf("FAILED: memory is allocated by the libraries!\n");
+        return (1);
+    }
+    return (0);
+}
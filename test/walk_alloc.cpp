@@ -0,0 +1,69 @@
+/**
+ * @file
+ * @author Alexander Sherikov
+ *
+ * @brief Check, that the control loop of the module does not allocate
+ * memory. The module is created in this process, connected to the
+ * simulated DCM (robotIOSim) and performs one walk with the parameters
+ * stored in the preferences. The module must be built with
+ * ORUW_ALLOC_TRACKING, in this case the walk fails, if memory is allocated
+ * between the first and the last loops.
+ *
+ * Requires NAOqi SDK and a running NAOqi, which provides ALPreferences;
+ * is built with the module if ORUW_ALLOC_TRACKING is set. The arguments
+ * are the IP address and the port of NAOqi (127.0.0.1 9559 by default).
+ */
+
+#include <cstdio>
+#include <cstdlib> // atoi
+
+#include <alcommon/albroker.h>
+#include <alcommon/albrokermanager.h>
+
+#include "oru_walk.h"
+#include "oruw_alloc.h"
+
+
+int main(int argc, char **argv)
+{
+#ifndef ORUW_ALLOC_TRACKING_ENABLE
+    printf("FAILED: the module is built without ORUW_ALLOC_TRACKING!\n");
+    return (1);
+#else
+    const char *parent_ip = (argc > 1) ? argv[1] : "127.0.0.1";
+    const int parent_port = (argc > 2) ? atoi(argv[2]) : 9559;
+
+    int result = 0;
+    try
+    {
+        ALPtr<ALBroker> broker = ALBroker::createBroker("walk_alloc", "0.0.0.0", 54010, parent_ip, parent_port);
+        ALBrokerManager::setInstance(broker->fBrokerManager.lock());
+        ALBrokerManager::getInstance()->addBroker(broker);
+
+        {
+            ALPtr<oru_walk> module (new oru_walk (broker, "oru_walk_alloc"));
+            module->forceSimulatedDCM();
+            module->init();
+
+            module->setStiffness(1.0);
+            module->initPosition();
+            module->walk();
+            // fails, if memory is allocated in the control loop
+            module->waitWalking();
+        }
+
+        broker->shutdown();
+    }
+    catch (const ALError &e)
+    {
+        printf("FAILED: %s\n", e.what());
+        result = 1;
+    }
+
+    if (result == 0)
+    {
+        printf("No memory is allocated in the control loop.\n");
+    }
+    return (result);
+#endif
+}